@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "corpus_index.h"
+#include "hash.h"
+#include "root_node.h"
+
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+
+// Odd multipliers, each of which permutes all 64 bit numbers differently
+static constexpr std::array<uint64_t, CorpusIndex::SIGNATURE_SIZE>
+GetPermutationMultipliers() {
+  std::array<uint64_t, CorpusIndex::SIGNATURE_SIZE> multipliers{};
+  for (uint32_t i = 0; i < CorpusIndex::SIGNATURE_SIZE; ++i) {
+    multipliers[i] = MixBits(i + 1) | 1;
+  }
+  return multipliers;
+}
+
+constexpr auto PERMUTATION_MULTIPLIERS = GetPermutationMultipliers();
+
+// Collect the hashes of all subtrees and properties below the given node. The
+// hashes of properties are combined with the name of their node, so that equal
+// properties of differently named nodes count as distinct elements.
+static void CollectElements(const Node &argNode,
+                            std::vector<uint64_t> &argElements) {
+  const auto nodeNameHash = HashString(
+      HashString(FNV_OFFSET_BASIS,
+                 NamePool::GetInstance().GetName(argNode.GetNameId())),
+      argNode.GetUnitAddress());
+  for (const auto item : argNode.GetItems()) {
+    if (item->GetType() == Item::Type::PROPERTY) {
+      argElements.emplace_back(HashNumber(nodeNameHash, item->GetHash()));
+      continue;
+    }
+
+    const auto &childNode = *static_cast<const Node *>(item);
+    argElements.emplace_back(childNode.GetHash());
+    CollectElements(childNode, argElements);
+  }
+}
+
+CorpusIndex::Fingerprint
+CorpusIndex::ComputeFingerprint(const RootNode &argRootNode) {
+  std::vector<uint64_t> elements;
+  elements.reserve(argRootNode.GetSubtreeSize());
+  CollectElements(argRootNode, elements);
+  std::sort(std::begin(elements), std::end(elements));
+  elements.erase(std::unique(std::begin(elements), std::end(elements)),
+                 std::end(elements));
+
+  // Each position of the signature holds the minimum of the elements under a
+  // different permutation of all hashes. The elements are scrambled once, so
+  // that a multiplication suffices for each permutation.
+  Fingerprint fingerprint{argRootNode.GetHash(), {}};
+  fingerprint.signature.fill(UINT64_MAX);
+  for (const auto element : elements) {
+    const auto mixedElement = MixBits(element);
+    for (uint32_t i = 0; i < SIGNATURE_SIZE; ++i) {
+      fingerprint.signature[i] = std::min(
+          fingerprint.signature[i], mixedElement * PERMUTATION_MULTIPLIERS[i]);
+    }
+  }
+
+  return fingerprint;
+}
+
+double CorpusIndex::EstimateSimilarity(const Fingerprint &argFingerprint1,
+                                       const Fingerprint &argFingerprint2) {
+  uint32_t equalQty = 0;
+  for (uint32_t i = 0; i < SIGNATURE_SIZE; ++i) {
+    if (argFingerprint1.signature[i] == argFingerprint2.signature[i]) {
+      ++equalQty;
+    }
+  }
+  return static_cast<double>(equalQty) / SIGNATURE_SIZE;
+}
+
+std::size_t CorpusIndex::Add(const Fingerprint &argFingerprint) {
+  fingerprints.emplace_back(argFingerprint);
+  return fingerprints.size() - 1;
+}
+
+std::vector<CorpusIndex::Cluster>
+CorpusIndex::GetClusters(const double argSimilarityThreshold) const {
+  // Group identical trees in a single pass
+  std::vector<std::vector<std::size_t>> groups;
+  std::unordered_map<uint64_t, std::size_t> groupIdxs;
+  for (std::size_t i = 0; i < fingerprints.size(); ++i) {
+    const auto insertResult =
+        groupIdxs.emplace(fingerprints[i].treeHash, groups.size());
+    if (insertResult.second == true) {
+      groups.emplace_back();
+    }
+    groups[insertResult.first->second].emplace_back(i);
+  }
+
+  // Link groups of near-duplicates, tracking the lowest similarity of each set
+  std::vector<std::size_t> parents(groups.size());
+  std::iota(std::begin(parents), std::end(parents), 0);
+  std::vector<double> similarities(groups.size(), 1.0);
+  const auto findRoot = [&parents](std::size_t argGroupIdx) {
+    while (parents[argGroupIdx] != argGroupIdx) {
+      parents[argGroupIdx] = parents[parents[argGroupIdx]];
+      argGroupIdx = parents[argGroupIdx];
+    }
+    return argGroupIdx;
+  };
+
+  // Groups sharing all rows of any band are candidates, which are compared
+  // against the earlier candidates of the same bucket until one is similar
+  // enough. Further links are not needed, as the groups are already connected.
+  std::unordered_map<uint64_t, std::vector<std::size_t>> buckets;
+  for (uint32_t band = 0; band < BAND_QTY; ++band) {
+    buckets.clear();
+    for (std::size_t groupIdx = 0; groupIdx < groups.size(); ++groupIdx) {
+      const auto &fingerprint = fingerprints[groups[groupIdx].front()];
+      auto bandHash = HashNumber(FNV_OFFSET_BASIS, band);
+      for (uint32_t row = 0; row < ROWS_PER_BAND; ++row) {
+        bandHash = HashNumber(
+            bandHash, fingerprint.signature[band * ROWS_PER_BAND + row]);
+      }
+
+      auto &bucket = buckets[bandHash];
+      for (const auto candidateIdx : bucket) {
+        const auto root = findRoot(groupIdx);
+        const auto candidateRoot = findRoot(candidateIdx);
+        if (root == candidateRoot) {
+          break;
+        }
+        const auto similarity = EstimateSimilarity(
+            fingerprint, fingerprints[groups[candidateIdx].front()]);
+        if (similarity >= argSimilarityThreshold) {
+          parents[root] = candidateRoot;
+          similarities[candidateRoot] =
+              std::min({similarities[root], similarities[candidateRoot],
+                        similarity});
+          break;
+        }
+      }
+      bucket.emplace_back(groupIdx);
+    }
+  }
+
+  std::vector<Cluster> clusters;
+  std::unordered_map<std::size_t, std::size_t> clusterIdxs;
+  for (std::size_t groupIdx = 0; groupIdx < groups.size(); ++groupIdx) {
+    const auto root = findRoot(groupIdx);
+    const auto insertResult = clusterIdxs.emplace(root, clusters.size());
+    if (insertResult.second == true) {
+      clusters.emplace_back();
+      clusters.back().similarity = similarities[root];
+    }
+    clusters[insertResult.first->second].groups.emplace_back(
+        std::move(groups[groupIdx]));
+  }
+
+  return clusters;
+}
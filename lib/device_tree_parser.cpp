@@ -22,11 +22,25 @@
  */
 
 #include "device_tree_parser.h"
+#include "arena.h"
+#include "line_reader.h"
+#include "mapped_file.h"
+#include "parse_cache.h"
+#include "property.h"
 #include "root_node.h"
+#include "string_utils.h"
+#include "thread_pool.h"
 
+#include <algorithm>
+#include <atomic>
 #include <exception>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include <vector>
 
 class InvalidLineException : public std::exception {
   const char *what() const noexcept override;
@@ -44,63 +58,67 @@ const char *UnsupportedDeviceTreeVersionException::what() const noexcept {
   return "The parsed device tree is of an unsupported version";
 }
 
-DeviceTreeParser::DeviceTreeParser(const std::string &argFilePath)
-    : deviceTreeFilePath{argFilePath} {}
+DeviceTreeParser::DeviceTreeParser(const std::string &argFilePath,
+                                   const bool argParseInParallel,
+                                   const ParseCache *const argParseCache,
+                                   ThreadPool *const argThreadPool,
+                                   std::ostream &argErrorStream)
+    : deviceTreeFilePath{argFilePath}, errorStream{argErrorStream},
+      parseInParallel{argParseInParallel}, parseCache{argParseCache},
+      threadPool{argThreadPool} {}
 
 DeviceTreeParser::~DeviceTreeParser() {}
 
 std::unique_ptr<RootNode> DeviceTreeParser::ParseFile() {
-  // Open the file and determine its size
-  std::ifstream inputFile;
-  inputFile.open(deviceTreeFilePath);
-  if (inputFile.fail()) {
-    std::cerr << "Failed to open device tree file: " << deviceTreeFilePath
-              << "\n";
-    return nullptr;
+  // Prefer parsing straight from a read-only mapping of the file
+  const MappedFile mappedFile{deviceTreeFilePath};
+  if (mappedFile.IsMapped()) {
+    return ParseBuffer(mappedFile.GetView());
   }
 
-  inputFile.seekg(0, std::ios_base::end);
-  if (inputFile.fail()) {
-    std::cerr << "Failed to seek to the end of file: " << deviceTreeFilePath
-              << "\n";
-    return nullptr;
-  }
-  const auto fileSize = inputFile.tellg();
-  if (fileSize < 0) {
-    std::cerr << "Retrieved invalid file size for file: " << deviceTreeFilePath
-              << "\n";
-    return nullptr;
-  }
-  inputFile.seekg(0);
+  // Fall back to reading the file into a buffer if it cannot be mapped (e.g.
+  // if it is empty or not a regular file)
+  std::ifstream inputFile;
+  inputFile.open(deviceTreeFilePath, std::ios_base::binary);
   if (inputFile.fail()) {
-    std::cerr << "Failed to seek to the start of file: " << deviceTreeFilePath
-              << "\n";
+    errorStream << "Failed to open device tree file: " << deviceTreeFilePath
+                << "\n";
     return nullptr;
   }
 
-  // Read the file into a buffer and close it afterwards
-  std::vector<uint8_t> inputBuf(
-      static_cast<std::vector<uint8_t>::size_type>(fileSize), 0);
-  inputFile.read(reinterpret_cast<char *>(inputBuf.data()), fileSize);
-  if (inputFile.gcount() != fileSize) {
-    std::cerr << "Failed to read file: " << deviceTreeFilePath << "\n";
+  std::string inputBuf{std::istreambuf_iterator<char>{inputFile},
+                       std::istreambuf_iterator<char>{}};
+  if (inputFile.bad()) {
+    errorStream << "Failed to read file: " << deviceTreeFilePath << "\n";
     return nullptr;
   }
   inputFile.close();
   if (inputFile.fail()) {
-    std::cerr << "Failed to close file: " << deviceTreeFilePath << "\n";
+    errorStream << "Failed to close file: " << deviceTreeFilePath << "\n";
     return nullptr;
   }
 
-  // Create a string and a stream object working on that string
-  std::string inputString{reinterpret_cast<char *>(inputBuf.data()),
-                          static_cast<std::string::size_type>(fileSize)};
-  std::istringstream inputStream{inputString};
+  return ParseBuffer(inputBuf);
+}
+
+std::unique_ptr<RootNode>
+DeviceTreeParser::ParseBuffer(const std::string_view argBuffer) {
+  // Unchanged sources are loaded from the parse cache instead of parsing them
+  ParseCache::Key cacheKey{};
+  if (parseCache != nullptr) {
+    cacheKey = ParseCache::GetKey(argBuffer);
+    auto rootNode = parseCache->Load(cacheKey, errorStream);
+    if (rootNode) {
+      return rootNode;
+    }
+  }
+
+  LineReader lineReader{argBuffer};
 
-  // Iterate over all the lines of the file
-  std::string line;
+  // Iterate over all the lines of the buffer
+  std::string_view line;
   std::unique_ptr<RootNode> rootNode;
-  while (std::getline(inputStream, line)) {
+  while (lineReader.GetLine(line)) {
     if (line.empty()) {
       continue;
     }
@@ -108,17 +126,145 @@ std::unique_ptr<RootNode> DeviceTreeParser::ParseFile() {
       deviceTreeVersion = 1;
       continue;
     }
+    // Overlays are parsed like any other tree, their fragments are only
+    // evaluated on applying them
+    if (line == "/plugin/;") {
+      continue;
+    }
     if (Node::IsNodeStartLine(line)) {
       // Verify device tree version before any other steps
       if (deviceTreeVersion != 1) {
         throw UnsupportedDeviceTreeVersionException{};
       }
 
-      rootNode = std::make_unique<RootNode>(line, inputStream);
+      if (parseInParallel) {
+        rootNode = ParseRootNodeInParallel(line, lineReader, argBuffer);
+      } else {
+        rootNode = std::make_unique<RootNode>(line, lineReader);
+      }
       continue;
     }
     throw InvalidLineException{};
   }
 
+  if (rootNode && (parseCache != nullptr)) {
+    parseCache->Store(cacheKey, *rootNode, errorStream);
+  }
+
+  return rootNode;
+}
+
+std::unique_ptr<RootNode> DeviceTreeParser::ParseRootNodeInParallel(
+    const std::string_view argLine, LineReader &argLineReader,
+    const std::string_view argBuffer) {
+  std::unique_ptr<RootNode> rootNode{
+      new RootNode{argLine, std::make_shared<Arena>()}};
+
+  // Pre-scan the root node's body for the byte ranges of its direct children
+  // by matching node start and end lines like Node::Node would do. The root
+  // node's properties are parsed right away and empty slots are reserved for
+  // the children to keep the source order.
+  std::vector<std::string_view> childRanges;
+  std::vector<std::pmr::vector<Item *>::size_type> childSlots;
+  std::string_view::size_type childStart = 0;
+  uint_fast32_t depth = 0;
+  const auto addChildRange = [&](const std::string_view::size_type argEnd) {
+    childSlots.emplace_back(rootNode->items.size());
+    rootNode->items.emplace_back(nullptr);
+    childRanges.emplace_back(argBuffer.substr(childStart, argEnd - childStart));
+  };
+  std::string_view line;
+  while (true) {
+    const auto lineStart = argLineReader.GetOffset();
+    if (argLineReader.GetLine(line) == false) {
+      // An unterminated child node extends up to the end of the buffer
+      if (depth > 0) {
+        addChildRange(argBuffer.size());
+      }
+      break;
+    }
+    if (RemoveLeadingWhitespace(line).empty()) {
+      continue;
+    }
+    if (Node::IsNodeStartLine(line)) {
+      if (depth == 0) {
+        childStart = lineStart;
+      }
+      ++depth;
+      continue;
+    }
+    if (Node::IsNodeEndLine(line)) {
+      if (depth == 0) {
+        break;
+      }
+      --depth;
+      if (depth == 0) {
+        addChildRange(std::min(argLineReader.GetOffset(), argBuffer.size()));
+      }
+      continue;
+    }
+    if (depth == 0) {
+      rootNode->items.emplace_back(Property::Construct(line, rootNode.get()));
+    }
+  }
+
+  // Build the child subtrees concurrently, each worker picking the next
+  // unparsed child until all are done. Every worker allocates into an arena of
+  // its own, which is handed over to the root node afterwards.
+  std::vector<Item *> children(childRanges.size());
+  std::vector<std::exception_ptr> errors(childRanges.size());
+  std::atomic<std::vector<std::string_view>::size_type> nextChild{0};
+  const auto parseChildren = [&](Arena &argArena) {
+    for (auto i = nextChild++; i < childRanges.size(); i = nextChild++) {
+      try {
+        LineReader childLineReader{childRanges[i]};
+        std::string_view childLine;
+        childLineReader.GetLine(childLine);
+        children[i] = argArena.Create<Node>(childLine, childLineReader,
+                                            rootNode.get(), argArena);
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    }
+  };
+  // The calling thread parses as well, helped by the workers of the thread
+  // pool. Without a given pool, a temporary one is used.
+  const auto workerQty = std::min<std::vector<std::string_view>::size_type>(
+      threadPool ? threadPool->GetThreadQty() + 1
+                 : std::max(1u, std::thread::hardware_concurrency()),
+      childRanges.size());
+  if (workerQty > 1) {
+    std::unique_ptr<ThreadPool> ownThreadPool;
+    auto pool = threadPool;
+    if (pool == nullptr) {
+      ownThreadPool =
+          std::make_unique<ThreadPool>(static_cast<unsigned>(workerQty - 1));
+      pool = ownThreadPool.get();
+    }
+    TaskGroup taskGroup{*pool};
+    for (auto i = 1u; i < workerQty; ++i) {
+      auto arena = std::make_shared<Arena>();
+      taskGroup.Run([&parseChildren, &arena = *arena]() {
+        parseChildren(arena);
+      });
+      rootNode->AdoptArena(std::move(arena));
+    }
+    parseChildren(rootNode->GetArena());
+    taskGroup.Wait();
+  } else {
+    parseChildren(rootNode->GetArena());
+  }
+
+  // Stitch the subtrees into their slots, reporting the first error in source
+  // order just like sequential parsing would
+  for (auto i = 0u; i < children.size(); ++i) {
+    if (errors[i]) {
+      std::rethrow_exception(errors[i]);
+    }
+    rootNode->items[childSlots[i]] = children[i];
+  }
+  rootNode->BuildChildIndex();
+  rootNode->UpdateHash();
+
   return rootNode;
 }
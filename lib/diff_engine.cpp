@@ -0,0 +1,246 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "diff_engine.h"
+#include "json.h"
+#include "property.h"
+#include "root_node.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+// Append a child's name to the device path of its parent node
+static void AppendToDevicePath(std::string &argPath, const Item &argItem) {
+  if (argPath.back() != '/') {
+    argPath.push_back('/');
+  }
+  argPath.append(argItem.GetName());
+}
+
+static void AppendJsonValue(std::string &argOutput, const char *argKey,
+                            const Item *argItem) {
+  argOutput.append(",\"");
+  argOutput.append(argKey);
+  argOutput.append("\":");
+  if (dynamic_cast<const PropertyEmpty *>(argItem) != nullptr) {
+    argOutput.append("null");
+    return;
+  }
+  AppendJsonString(argOutput,
+                   static_cast<const Property *>(argItem)->GetValueStringRep());
+}
+
+std::string Difference::GetJsonLine() const {
+  const auto item = item1 ? item1 : item2;
+
+  std::string resultStr{"{\"type\":"};
+  switch (type) {
+  case Type::ADDED:
+    resultStr.append("\"added\"");
+    break;
+  case Type::CHANGED:
+    resultStr.append("\"changed\"");
+    break;
+  case Type::REMOVED:
+    resultStr.append("\"removed\"");
+    break;
+  }
+  resultStr.append(",\"path\":");
+  AppendJsonString(resultStr, path);
+  if (item->GetType() != Item::Type::PROPERTY) {
+    resultStr.append(",\"item\":\"node\"}");
+    return resultStr;
+  }
+
+  resultStr.append(",\"item\":\"property\",\"name\":");
+  AppendJsonString(resultStr, item->GetName());
+  if (item1 != nullptr) {
+    AppendJsonValue(resultStr, "old", item1);
+  }
+  if (item2 != nullptr) {
+    AppendJsonValue(resultStr, "new", item2);
+  }
+  resultStr.push_back('}');
+  return resultStr;
+}
+
+// Differences of a subtree, into which the differences of subtrees diffed by
+// separate tasks are spliced afterwards
+struct DiffEngine::Chunk {
+  std::vector<Difference> differences;
+  // The chunks of the separately diffed subtrees and the number of differences
+  // preceding them
+  std::vector<
+      std::pair<std::vector<Difference>::size_type, std::unique_ptr<Chunk>>>
+      subChunks;
+};
+
+DiffEngine::DiffEngine(const bool argStopAtFirstDifference,
+                       const bool argVerifyHashMatches,
+                       ThreadPool *const argThreadPool,
+                       const uint32_t argSplitThreshold)
+    : stopAtFirstDifference{argStopAtFirstDifference},
+      verifyHashMatches{argVerifyHashMatches}, threadPool{argThreadPool},
+      splitThreshold{argSplitThreshold} {}
+
+bool DiffEngine::AddDifference(Chunk &argChunk,
+                               const Difference::Type argType,
+                               const std::string &argPath,
+                               const Item *const argItem1,
+                               const Item *const argItem2) {
+  const auto item = argItem1 ? argItem1 : argItem2;
+  if (item->GetType() == Item::Type::PROPERTY) {
+    argChunk.differences.push_back({argType, argPath, argItem1, argItem2});
+  } else {
+    auto nodePath = argPath;
+    AppendToDevicePath(nodePath, *item);
+    argChunk.differences.push_back(
+        {argType, std::move(nodePath), argItem1, argItem2});
+  }
+
+  if (stopAtFirstDifference == true) {
+    stopped = true;
+    return false;
+  }
+  return true;
+}
+
+void DiffEngine::CollectDifferences(Chunk &argChunk,
+                                    std::vector<Difference> &argDifferences) {
+  std::vector<Difference>::size_type collectedQty = 0;
+  for (auto &subChunk : argChunk.subChunks) {
+    std::move(std::begin(argChunk.differences) + collectedQty,
+              std::begin(argChunk.differences) + subChunk.first,
+              std::back_inserter(argDifferences));
+    collectedQty = subChunk.first;
+    CollectDifferences(*subChunk.second, argDifferences);
+  }
+  std::move(std::begin(argChunk.differences) + collectedQty,
+            std::end(argChunk.differences), std::back_inserter(argDifferences));
+}
+
+std::vector<Difference> DiffEngine::Diff(const RootNode &argRootNode1,
+                                         const RootNode &argRootNode2) {
+  return Diff(argRootNode1, argRootNode2, "/");
+}
+
+std::vector<Difference> DiffEngine::Diff(const Node &argNode1,
+                                         const Node &argNode2,
+                                         const std::string &argPath) {
+  stopped = false;
+  Chunk chunk;
+  auto path = argPath;
+  if (threadPool == nullptr) {
+    DiffNodes(argNode1, argNode2, path, chunk, nullptr);
+  } else {
+    TaskGroup taskGroup{*threadPool};
+    DiffNodes(argNode1, argNode2, path, chunk, &taskGroup);
+    taskGroup.Wait();
+  }
+
+  std::vector<Difference> differences;
+  CollectDifferences(chunk, differences);
+  // Concurrent tasks may have found further differences before stopping
+  if ((stopAtFirstDifference == true) && (differences.size() > 1)) {
+    differences.resize(1);
+  }
+  return differences;
+}
+
+bool DiffEngine::DiffNodes(const Node &argNode1, const Node &argNode2,
+                           std::string &argPath, Chunk &argChunk,
+                           TaskGroup *const argTaskGroup) {
+  if (stopped == true) {
+    return false;
+  }
+
+  // Equal hashes mean equal subtrees
+  if ((verifyHashMatches == false) && (argNode1.Compare(&argNode2) == true)) {
+    return true;
+  }
+
+  // Items are matched by name and kind like on applying overlays, so a node
+  // replaced by a property of the same name or vice versa is removed and added
+  for (const auto item1 : argNode1.GetItems()) {
+    const auto item2 =
+        argNode2.FindItem(item1->GetNameId(), item1->GetUnitAddressId(),
+                          item1->GetType() == Item::Type::PROPERTY);
+    if (item2 == nullptr) {
+      if (AddDifference(argChunk, Difference::Type::REMOVED, argPath, item1,
+                        nullptr) == false) {
+        return false;
+      }
+      continue;
+    }
+
+    if (item1->GetType() == Item::Type::PROPERTY) {
+      if ((item1->Compare(item2) == false) &&
+          (AddDifference(argChunk, Difference::Type::CHANGED, argPath, item1,
+                         item2) == false)) {
+        return false;
+      }
+      continue;
+    }
+
+    const auto node1 = static_cast<const Node *>(item1);
+    const auto node2 = static_cast<const Node *>(item2);
+    const auto pathSize = argPath.size();
+    AppendToDevicePath(argPath, *node1);
+
+    // Large subtrees are diffed by separate tasks into chunks of their own
+    if ((argTaskGroup != nullptr) &&
+        (node1->GetSubtreeSize() >= splitThreshold)) {
+      argChunk.subChunks.emplace_back(argChunk.differences.size(),
+                                      std::make_unique<Chunk>());
+      argTaskGroup->Run([this, node1, node2, path = argPath,
+                         &subChunk = *argChunk.subChunks.back().second,
+                         argTaskGroup]() mutable {
+        DiffNodes(*node1, *node2, path, subChunk, argTaskGroup);
+      });
+      argPath.resize(pathSize);
+      continue;
+    }
+
+    const auto proceed = DiffNodes(*node1, *node2, argPath, argChunk,
+                                   argTaskGroup);
+    argPath.resize(pathSize);
+    if (proceed == false) {
+      return false;
+    }
+  }
+
+  for (const auto item2 : argNode2.GetItems()) {
+    if ((argNode1.FindItem(item2->GetNameId(), item2->GetUnitAddressId(),
+                           item2->GetType() == Item::Type::PROPERTY) ==
+         nullptr) &&
+        (AddDifference(argChunk, Difference::Type::ADDED, argPath, nullptr,
+                       item2) == false)) {
+      return false;
+    }
+  }
+
+  return true;
+}
@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "dtb_parser.h"
+#include "arena.h"
+#include "fdt.h"
+#include "mapped_file.h"
+#include "property.h"
+#include "root_node.h"
+
+#include <cstddef>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <memory>
+
+class InvalidDtbException : public std::exception {
+  const char *what() const noexcept override;
+};
+
+const char *InvalidDtbException::what() const noexcept {
+  return "Encountered invalid structure on device tree blob parsing";
+}
+
+class UnsupportedDtbVersionException : public std::exception {
+  const char *what() const noexcept override;
+};
+
+const char *UnsupportedDtbVersionException::what() const noexcept {
+  return "The parsed device tree blob is of an unsupported version";
+}
+
+// Nesting limit protecting the stack against malicious blobs
+constexpr unsigned MAX_DTB_DEPTH = 512;
+
+DtbParser::DtbParser(const std::string &argFilePath,
+                     std::ostream &argErrorStream)
+    : dtbFilePath{argFilePath}, errorStream{argErrorStream} {}
+
+DtbParser::~DtbParser() {}
+
+bool DtbParser::IsDtbFile(const std::string &argFilePath) {
+  std::ifstream inputFile{argFilePath, std::ios_base::binary};
+  char magic[sizeof(uint32_t)];
+  if (inputFile.read(magic, sizeof(magic)).gcount() != sizeof(magic)) {
+    return false;
+  }
+  return ReadBigEndianU32(magic) == FDT_MAGIC;
+}
+
+std::unique_ptr<RootNode> DtbParser::ParseFile() {
+  const MappedFile mappedFile{dtbFilePath};
+  if (mappedFile.IsMapped() == false) {
+    errorStream << "Failed to map device tree blob file: " << dtbFilePath
+                << "\n";
+    return nullptr;
+  }
+
+  return ParseBlob(mappedFile.GetView());
+}
+
+std::unique_ptr<RootNode> DtbParser::ParseBlob(const std::string_view argBlob) {
+  if (argBlob.size() < FDT_HEADER_SIZE) {
+    throw InvalidDtbException{};
+  }
+
+  const auto readHeaderField = [&argBlob](const uint32_t argFieldOffset) {
+    return ReadBigEndianU32(argBlob.data() + argFieldOffset);
+  };
+  const auto magic = readHeaderField(offsetof(FdtHeader, magic));
+  const auto totalSize = readHeaderField(offsetof(FdtHeader, totalSize));
+  const auto offDtStruct = readHeaderField(offsetof(FdtHeader, offDtStruct));
+  const auto offDtStrings = readHeaderField(offsetof(FdtHeader, offDtStrings));
+  const auto version = readHeaderField(offsetof(FdtHeader, version));
+  const auto lastCompVersion =
+      readHeaderField(offsetof(FdtHeader, lastCompVersion));
+  const auto sizeDtStrings =
+      readHeaderField(offsetof(FdtHeader, sizeDtStrings));
+  const auto sizeDtStruct = readHeaderField(offsetof(FdtHeader, sizeDtStruct));
+
+  if ((magic != FDT_MAGIC) || (totalSize > argBlob.size())) {
+    throw InvalidDtbException{};
+  }
+  // The structure block size is only part of the header since version 17
+  if ((version < FDT_VERSION) || (lastCompVersion > FDT_VERSION)) {
+    throw UnsupportedDtbVersionException{};
+  }
+  if ((offDtStruct > totalSize) || (sizeDtStruct > totalSize - offDtStruct) ||
+      (offDtStrings > totalSize) ||
+      (sizeDtStrings > totalSize - offDtStrings)) {
+    throw InvalidDtbException{};
+  }
+
+  // Both blocks are only referenced and never copied
+  structBlock = argBlob.substr(offDtStruct, sizeDtStruct);
+  stringsBlock = argBlob.substr(offDtStrings, sizeDtStrings);
+  structOffset = 0;
+
+  // Skip any NOP tokens preceding the root node
+  auto token = ReadToken();
+  while (token == FDT_NOP) {
+    token = ReadToken();
+  }
+  if ((token != FDT_BEGIN_NODE) || (ReadNodeName().empty() == false)) {
+    throw InvalidDtbException{};
+  }
+
+  std::unique_ptr<RootNode> rootNode{new RootNode{std::make_shared<Arena>()}};
+  ParseNodeContents(*rootNode);
+
+  token = ReadToken();
+  while (token == FDT_NOP) {
+    token = ReadToken();
+  }
+  if (token != FDT_END) {
+    throw InvalidDtbException{};
+  }
+
+  return rootNode;
+}
+
+void DtbParser::ParseNodeContents(Node &argNode) {
+  while (true) {
+    const auto token = ReadToken();
+    switch (token) {
+    case FDT_BEGIN_NODE: {
+      if (argNode.GetLevel() >= MAX_DTB_DEPTH) {
+        throw InvalidDtbException{};
+      }
+      const auto nodeName = ReadNodeName();
+      const auto atPos = nodeName.find('@');
+      auto &arena = argNode.GetArena();
+      const auto childNode = arena.Create<Node>(
+          nodeName.substr(0, atPos),
+          atPos == std::string_view::npos ? std::string_view{}
+                                          : nodeName.substr(atPos + 1),
+          &argNode, arena);
+      ParseNodeContents(*childNode);
+      argNode.items.emplace_back(childNode);
+      break;
+    }
+    case FDT_END_NODE:
+      argNode.BuildChildIndex();
+      argNode.UpdateHash();
+      return;
+    case FDT_PROP: {
+      const auto valueLength = ReadToken();
+      const auto nameOffset = ReadToken();
+      if ((valueLength > structBlock.size() - structOffset) ||
+          (nameOffset >= stringsBlock.size())) {
+        throw InvalidDtbException{};
+      }
+      const auto nameEnd = stringsBlock.find('\0', nameOffset);
+      if (nameEnd == std::string_view::npos) {
+        throw InvalidDtbException{};
+      }
+      const auto name = stringsBlock.substr(nameOffset, nameEnd - nameOffset);
+      const auto value = structBlock.substr(structOffset, valueLength);
+      structOffset = AlignToFdtToken(structOffset + valueLength);
+
+      argNode.items.emplace_back(
+          Property::ConstructFromBlob(name, value, &argNode));
+      break;
+    }
+    case FDT_NOP:
+      break;
+    default:
+      throw InvalidDtbException{};
+    }
+  }
+}
+
+uint32_t DtbParser::ReadToken() {
+  if ((structOffset > structBlock.size()) ||
+      (structBlock.size() - structOffset < sizeof(uint32_t))) {
+    throw InvalidDtbException{};
+  }
+  const auto token = ReadBigEndianU32(structBlock.data() + structOffset);
+  structOffset += sizeof(uint32_t);
+  return token;
+}
+
+std::string_view DtbParser::ReadNodeName() {
+  const auto nameEnd = structBlock.find('\0', structOffset);
+  if (nameEnd == std::string_view::npos) {
+    throw InvalidDtbException{};
+  }
+  const auto nodeName =
+      structBlock.substr(structOffset, nameEnd - structOffset);
+  structOffset = AlignToFdtToken(static_cast<uint32_t>(nameEnd + 1));
+  return nodeName;
+}
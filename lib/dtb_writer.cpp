@@ -0,0 +1,301 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "dtb_writer.h"
+#include "fdt.h"
+#include "property.h"
+#include "root_node.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <typeinfo>
+
+// The memory reservation block only holds its terminating all-zero entry
+constexpr uint32_t FDT_RESERVE_ENTRY_SIZE = 2 * sizeof(uint64_t);
+constexpr uint32_t FDT_MEM_RSVMAP_ALIGNMENT = 8;
+// Values 0 and 0xffffffff are no valid phandles
+constexpr uint32_t MAXIMUM_PHANDLE = 0xfffffffe;
+
+static void PadToFdtToken(std::string &argOutput) {
+  argOutput.resize(AlignToFdtToken(static_cast<uint32_t>(argOutput.size())),
+                   '\0');
+}
+
+DtbWriter::DtbWriter(const std::string &argFilePath,
+                     std::ostream &argErrorStream)
+    : dtbFilePath{argFilePath}, errorStream{argErrorStream} {}
+
+DtbWriter::~DtbWriter() {}
+
+bool DtbWriter::WriteFile(const RootNode &argRootNode) {
+  structBlock.clear();
+  stringsBlock.clear();
+  stringOffsets.clear();
+  labelledNodes.clear();
+  phandles.clear();
+  generatedPhandles.clear();
+  referencePhandles.clear();
+
+  // References are resolved up front like dtc does, since blobs only hold
+  // the phandle values of the referenced nodes
+  uint32_t highestPhandle = 0;
+  if ((CollectLabels(argRootNode, highestPhandle) == false) ||
+      (ResolveReferences(argRootNode, argRootNode, highestPhandle) == false)) {
+    return false;
+  }
+
+  // Serialize structure and strings block in a single pass over the tree
+  try {
+    SerializeNode(argRootNode);
+  } catch (const std::exception &argException) {
+    errorStream << "Failed to encode device tree blob file: " << dtbFilePath
+                << " (" << argException.what() << ")\n";
+    return false;
+  }
+  AppendToken(FDT_END);
+
+  // Lay out header, memory reservation block, structure and strings block
+  const auto offMemRsvmap =
+      (FDT_HEADER_SIZE + FDT_MEM_RSVMAP_ALIGNMENT - 1) &
+      ~(FDT_MEM_RSVMAP_ALIGNMENT - 1);
+  const auto offDtStruct = offMemRsvmap + FDT_RESERVE_ENTRY_SIZE;
+  const auto offDtStrings =
+      offDtStruct + static_cast<uint32_t>(structBlock.size());
+  const auto totalSize =
+      offDtStrings + static_cast<uint32_t>(stringsBlock.size());
+
+  std::string blob;
+  blob.reserve(totalSize);
+  AppendBigEndianU32(blob, FDT_MAGIC);
+  AppendBigEndianU32(blob, totalSize);
+  AppendBigEndianU32(blob, offDtStruct);
+  AppendBigEndianU32(blob, offDtStrings);
+  AppendBigEndianU32(blob, offMemRsvmap);
+  AppendBigEndianU32(blob, FDT_VERSION);
+  AppendBigEndianU32(blob, FDT_LAST_COMPATIBLE_VERSION);
+  AppendBigEndianU32(blob, 0); // boot_cpuid_phys
+  AppendBigEndianU32(blob, static_cast<uint32_t>(stringsBlock.size()));
+  AppendBigEndianU32(blob, static_cast<uint32_t>(structBlock.size()));
+  blob.resize(offDtStruct, '\0');
+  blob.append(structBlock);
+  blob.append(stringsBlock);
+
+  std::ofstream outputFile{dtbFilePath,
+                           std::ios_base::binary | std::ios_base::trunc};
+  if (outputFile.fail()) {
+    errorStream << "Failed to open device tree blob file: " << dtbFilePath
+                << "\n";
+    return false;
+  }
+  outputFile.write(blob.data(), static_cast<std::streamsize>(blob.size()));
+  outputFile.close();
+  if (outputFile.fail()) {
+    errorStream << "Failed to write device tree blob file: " << dtbFilePath
+                << "\n";
+    return false;
+  }
+
+  return true;
+}
+
+void DtbWriter::AppendProperty(const NamePool::NameId argNameId,
+                               const std::string &argValue) {
+  AppendToken(FDT_PROP);
+  AppendToken(static_cast<uint32_t>(argValue.size()));
+  AppendToken(GetStringOffset(argNameId));
+  structBlock.append(argValue);
+  PadToFdtToken(structBlock);
+}
+
+void DtbWriter::AppendToken(const uint32_t argToken) {
+  AppendBigEndianU32(structBlock, argToken);
+}
+
+bool DtbWriter::CollectLabels(const Node &argNode,
+                              uint32_t &argHighestPhandle) {
+  if (argNode.GetLabelId() != NamePool::EMPTY_NAME_ID) {
+    if (labelledNodes.emplace(argNode.GetLabel(), &argNode).second == false) {
+      errorStream << "Duplicate label " << argNode.GetLabel()
+                  << " for device tree blob file: " << dtbFilePath << "\n";
+      return false;
+    }
+  }
+
+  for (const auto &item : argNode.items) {
+    if (item->GetType() != Item::Type::PROPERTY) {
+      if (CollectLabels(*static_cast<const Node *>(item), argHighestPhandle) ==
+          false) {
+        return false;
+      }
+      continue;
+    }
+
+    // Only plain single cell values are phandles, but no references
+    const auto &name = NamePool::GetInstance().GetName(item->GetNameId());
+    if ((name != "phandle") && (name != "linux,phandle")) {
+      continue;
+    }
+    if (typeid(*item) != typeid(PropertyValueU32)) {
+      continue;
+    }
+    const auto &cells = static_cast<const PropertyValueU32 *>(item)->GetCells();
+    if (cells.size() != 1) {
+      continue;
+    }
+    phandles.emplace(&argNode, cells.front());
+    argHighestPhandle = std::max(argHighestPhandle, cells.front());
+  }
+
+  return true;
+}
+
+std::string DtbWriter::EncodeProperty(const Property &argProperty) const {
+  const auto phandleProperty =
+      dynamic_cast<const PropertyValuePHandle *>(&argProperty);
+  if (phandleProperty == nullptr) {
+    return argProperty.GetEncodedValue();
+  }
+
+  const auto &cells = phandleProperty->GetCells();
+  const auto &references = phandleProperty->GetReferences();
+  std::string value;
+  value.reserve(cells.size() * sizeof(uint32_t));
+  std::pmr::vector<PropertyValuePHandle::Reference>::size_type nextReference =
+      0;
+  for (std::pmr::vector<uint32_t>::size_type i = 0; i < cells.size(); ++i) {
+    if ((nextReference < references.size()) &&
+        (references[nextReference].cellIndex == i)) {
+      AppendBigEndianU32(
+          value, referencePhandles.at(references[nextReference].label));
+      ++nextReference;
+      continue;
+    }
+    AppendBigEndianU32(value, cells[i]);
+  }
+  return value;
+}
+
+uint32_t DtbWriter::GetStringOffset(const NamePool::NameId argNameId) {
+  // Each property name is stored only once in the strings block
+  const auto insertResult = stringOffsets.emplace(
+      argNameId, static_cast<uint32_t>(stringsBlock.size()));
+  if (insertResult.second == true) {
+    stringsBlock.append(NamePool::GetInstance().GetName(argNameId));
+    stringsBlock.push_back('\0');
+  }
+  return insertResult.first->second;
+}
+
+bool DtbWriter::ResolveReferences(const RootNode &argRootNode,
+                                  const Node &argNode,
+                                  uint32_t &argHighestPhandle) {
+  for (const auto &item : argNode.items) {
+    if (item->GetType() != Item::Type::PROPERTY) {
+      if (ResolveReferences(argRootNode, *static_cast<const Node *>(item),
+                            argHighestPhandle) == false) {
+        return false;
+      }
+      continue;
+    }
+
+    const auto property = dynamic_cast<const PropertyValuePHandle *>(item);
+    if (property == nullptr) {
+      continue;
+    }
+    for (const auto &reference : property->GetReferences()) {
+      const auto label = reference.label;
+      if (referencePhandles.count(label) != 0) {
+        continue;
+      }
+
+      // Besides labels nodes can be referenced by path (e.g. "&{/soc/gic}")
+      const Node *referencedNode = nullptr;
+      if ((label.size() > 2) && (label.front() == '{') &&
+          (label.back() == '}')) {
+        referencedNode = argRootNode.Find(label.substr(1, label.size() - 2));
+      } else {
+        const auto labelledNodeIt = labelledNodes.find(label);
+        if (labelledNodeIt != std::end(labelledNodes)) {
+          referencedNode = labelledNodeIt->second;
+        }
+      }
+      if (referencedNode == nullptr) {
+        errorStream << "Failed to resolve reference &" << label
+                    << " for device tree blob file: " << dtbFilePath << "\n";
+        return false;
+      }
+
+      auto phandleIt = phandles.find(referencedNode);
+      if (phandleIt == std::end(phandles)) {
+        if (argHighestPhandle >= MAXIMUM_PHANDLE) {
+          errorStream << "Ran out of phandle values for device tree blob file: "
+                      << dtbFilePath << "\n";
+          return false;
+        }
+        phandleIt = phandles.emplace(referencedNode, ++argHighestPhandle).first;
+        generatedPhandles.emplace(referencedNode);
+      }
+      referencePhandles.emplace(label, phandleIt->second);
+    }
+  }
+
+  return true;
+}
+
+void DtbWriter::SerializeNode(const Node &argNode) {
+  AppendToken(FDT_BEGIN_NODE);
+  // The root node has an empty name in device tree blobs
+  if (argNode.GetType() != Item::Type::ROOT_NODE) {
+    structBlock.append(argNode.GetName());
+  }
+  structBlock.push_back('\0');
+  PadToFdtToken(structBlock);
+
+  // All properties of a node must precede its subnodes, even if merging
+  // appended properties behind them
+  for (const auto &item : argNode.items) {
+    if (item->GetType() != Item::Type::PROPERTY) {
+      continue;
+    }
+
+    AppendProperty(item->GetNameId(),
+                   EncodeProperty(*static_cast<const Property *>(item)));
+  }
+  // Like dtc add the phandle property to referenced nodes lacking one
+  if (generatedPhandles.count(&argNode) != 0) {
+    std::string value;
+    AppendBigEndianU32(value, phandles.at(&argNode));
+    AppendProperty(NamePool::GetInstance().Intern("phandle"), value);
+  }
+
+  for (const auto &item : argNode.items) {
+    if (item->GetType() != Item::Type::PROPERTY) {
+      SerializeNode(*static_cast<const Node *>(item));
+    }
+  }
+
+  AppendToken(FDT_END_NODE);
+}
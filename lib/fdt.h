@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef FDT_H
+#define FDT_H
+
+#include <cstdint>
+#include <string>
+
+// Layout of flattened device tree (FDT) blobs as given by the Devicetree
+// Specification, chapter 5. All values are stored in big-endian byte order.
+
+constexpr uint32_t FDT_MAGIC = 0xd00dfeed;
+constexpr uint32_t FDT_VERSION = 17;
+constexpr uint32_t FDT_LAST_COMPATIBLE_VERSION = 16;
+
+constexpr uint32_t FDT_BEGIN_NODE = 0x00000001;
+constexpr uint32_t FDT_END_NODE = 0x00000002;
+constexpr uint32_t FDT_PROP = 0x00000003;
+constexpr uint32_t FDT_NOP = 0x00000004;
+constexpr uint32_t FDT_END = 0x00000009;
+
+constexpr uint32_t FDT_TOKEN_ALIGNMENT = 4;
+
+struct FdtHeader {
+  uint32_t magic;
+  uint32_t totalSize;
+  uint32_t offDtStruct;
+  uint32_t offDtStrings;
+  uint32_t offMemRsvmap;
+  uint32_t version;
+  uint32_t lastCompVersion;
+  uint32_t bootCpuidPhys;
+  uint32_t sizeDtStrings;
+  uint32_t sizeDtStruct;
+};
+
+constexpr uint32_t FDT_HEADER_SIZE = sizeof(FdtHeader);
+
+inline uint32_t ReadBigEndianU32(const char *argData) noexcept {
+  const auto bytes = reinterpret_cast<const unsigned char *>(argData);
+  return (static_cast<uint32_t>(bytes[0]) << 24) |
+         (static_cast<uint32_t>(bytes[1]) << 16) |
+         (static_cast<uint32_t>(bytes[2]) << 8) |
+         static_cast<uint32_t>(bytes[3]);
+}
+
+inline void AppendBigEndianU32(std::string &argOutput,
+                               const uint32_t argValue) {
+  argOutput.push_back(static_cast<char>((argValue >> 24) & 0xff));
+  argOutput.push_back(static_cast<char>((argValue >> 16) & 0xff));
+  argOutput.push_back(static_cast<char>((argValue >> 8) & 0xff));
+  argOutput.push_back(static_cast<char>(argValue & 0xff));
+}
+
+constexpr uint32_t AlignToFdtToken(const uint32_t argOffset) noexcept {
+  return (argOffset + FDT_TOKEN_ALIGNMENT - 1) & ~(FDT_TOKEN_ALIGNMENT - 1);
+}
+
+#endif // FDT_H
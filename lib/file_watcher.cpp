@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "file_watcher.h"
+
+#include <poll.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/inotify.h>
+#endif
+
+#include <cerrno>
+#include <cstddef>
+#include <filesystem>
+
+// Interval in which the files are polled if inotify is not available
+constexpr int POLL_INTERVAL_MS = 50;
+
+FileWatcher::FileWatcher(const std::vector<std::string> &argFilePaths) {
+  for (const auto &filePath : argFilePaths) {
+    fileNames.emplace(std::filesystem::path{filePath}.filename().string());
+  }
+
+#if defined(__linux__)
+  inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotifyFd < 0) {
+    return;
+  }
+  for (const auto &filePath : argFilePaths) {
+    auto directory = std::filesystem::path{filePath}.parent_path();
+    if (directory.empty() == true) {
+      directory = ".";
+    }
+    // Files are complete once they have been closed or moved into place
+    if (inotify_add_watch(inotifyFd, directory.c_str(),
+                          IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+      close(inotifyFd);
+      inotifyFd = -1;
+      return;
+    }
+  }
+#endif
+}
+
+FileWatcher::~FileWatcher() {
+  if (inotifyFd >= 0) {
+    close(inotifyFd);
+  }
+}
+
+bool FileWatcher::Wait(const int argInterruptFd) {
+  while (true) {
+    pollfd fds[2] = {{argInterruptFd, POLLIN, 0}, {inotifyFd, POLLIN, 0}};
+    const auto result = poll(fds, IsPolling() ? 1 : 2,
+                             IsPolling() ? POLL_INTERVAL_MS : -1);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return true;
+    }
+    if ((fds[0].revents & POLLIN) != 0) {
+      return false;
+    }
+    if ((IsPolling() == true) || (ReadEvents() == true)) {
+      return true;
+    }
+  }
+}
+
+bool FileWatcher::ReadEvents() {
+#if defined(__linux__)
+  alignas(inotify_event) char buffer[4096];
+  bool concernsFiles = false;
+  while (true) {
+    const auto readSize = read(inotifyFd, buffer, sizeof(buffer));
+    if (readSize <= 0) {
+      return concernsFiles;
+    }
+    for (ssize_t offset = 0; offset < readSize;) {
+      const auto event =
+          reinterpret_cast<const inotify_event *>(buffer + offset);
+      // Events may have been lost if the queue overflowed
+      if (((event->mask & IN_Q_OVERFLOW) != 0) ||
+          ((event->len > 0) && (fileNames.count(event->name) != 0))) {
+        concernsFiles = true;
+      }
+      offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+    }
+  }
+#else
+  return true;
+#endif
+}
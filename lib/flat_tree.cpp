@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "flat_tree.h"
+#include "hash.h"
+#include "property.h"
+#include "root_node.h"
+
+#include <algorithm>
+#include <tuple>
+
+template <typename T>
+static void AppendRawBytes(std::string &argOutput, const T *argData,
+                           const std::size_t argCount) {
+  argOutput.append(reinterpret_cast<const char *>(argData),
+                   argCount * sizeof(T));
+}
+
+template <typename T>
+static uint64_t HashArray(const uint64_t argHash,
+                          const std::vector<T> &argArray) {
+  return HashBytes(argHash, argArray.data(), argArray.size() * sizeof(T));
+}
+
+FlatTree::FlatTree(const RootNode &argRootNode) {
+  valueOffsets.push_back(0);
+  AddItem(argRootNode, NO_INDEX);
+}
+
+FlatTree::Index FlatTree::AddItem(const Item &argItem, const Index argParent) {
+  const auto index = GetSize();
+  kinds.push_back(Kind::NODE);
+  nameIds.push_back(argItem.GetNameId());
+  unitAddressIds.push_back(argItem.GetUnitAddressId());
+  parents.push_back(argParent);
+  firstChildren.push_back(NO_INDEX);
+  nextSiblings.push_back(NO_INDEX);
+
+  if (argItem.GetType() == Item::Type::PROPERTY) {
+    AppendValue(static_cast<const Property &>(argItem), kinds[index]);
+    valueOffsets.push_back(static_cast<Index>(values.size()));
+    return index;
+  }
+
+  valueOffsets.push_back(static_cast<Index>(values.size()));
+  AddChildren(static_cast<const Node &>(argItem), index);
+  return index;
+}
+
+void FlatTree::AddChildren(const Node &argNode, const Index argIndex) {
+  // Bring the children into a canonical order, keeping the source order of
+  // items with the same name
+  const auto &items = argNode.GetItems();
+  std::vector<const Item *> children(std::begin(items), std::end(items));
+  std::stable_sort(std::begin(children), std::end(children),
+                   [](const Item *const argLhs, const Item *const argRhs) {
+                     return std::make_tuple(argLhs->GetType(),
+                                            argLhs->GetNameId(),
+                                            argLhs->GetUnitAddressId()) <
+                            std::make_tuple(argRhs->GetType(),
+                                            argRhs->GetNameId(),
+                                            argRhs->GetUnitAddressId());
+                   });
+
+  auto previousChild = NO_INDEX;
+  for (const auto child : children) {
+    const auto childIndex = AddItem(*child, argIndex);
+    if (previousChild == NO_INDEX) {
+      firstChildren[argIndex] = childIndex;
+    } else {
+      nextSiblings[previousChild] = childIndex;
+    }
+    previousChild = childIndex;
+  }
+}
+
+void FlatTree::AppendValue(const Property &argProperty, Kind &argKind) {
+  switch (argProperty.GetValueType()) {
+  case Property::ValueType::EMPTY:
+    argKind = Kind::PROPERTY_EMPTY;
+    return;
+  case Property::ValueType::PHANDLE: {
+    argKind = Kind::PROPERTY_PHANDLE;
+    const auto &property =
+        static_cast<const PropertyValuePHandle &>(argProperty);
+    const auto &cells = property.GetCells();
+    AppendRawBytes(values, cells.data(), cells.size());
+    for (const auto &reference : property.GetReferences()) {
+      AppendRawBytes(values, &reference.cellIndex, 1);
+      const auto labelSize = static_cast<uint32_t>(reference.label.size());
+      AppendRawBytes(values, &labelSize, 1);
+      values.append(reference.label);
+    }
+    return;
+  }
+  case Property::ValueType::STRING:
+    argKind = Kind::PROPERTY_STRING;
+    values.append(
+        static_cast<const PropertyValueString &>(argProperty).GetValue());
+    return;
+  case Property::ValueType::STRING_LIST:
+    argKind = Kind::PROPERTY_STRING_LIST;
+    values.append(argProperty.GetEncodedValue());
+    return;
+  case Property::ValueType::U32: {
+    argKind = Kind::PROPERTY_U32;
+    const auto &cells =
+        static_cast<const PropertyValueU32 &>(argProperty).GetCells();
+    AppendRawBytes(values, cells.data(), cells.size());
+    return;
+  }
+  case Property::ValueType::U64: {
+    argKind = Kind::PROPERTY_U64;
+    const auto &cells =
+        static_cast<const PropertyValueU64 &>(argProperty).GetCells();
+    AppendRawBytes(values, cells.data(), cells.size());
+    return;
+  }
+  }
+}
+
+bool FlatTree::Compare(const FlatTree &argOtherTree) const {
+  // Equal trees have identical arrays due to the canonical item order
+  return (kinds == argOtherTree.kinds) && (nameIds == argOtherTree.nameIds) &&
+         (unitAddressIds == argOtherTree.unitAddressIds) &&
+         (parents == argOtherTree.parents) &&
+         (valueOffsets == argOtherTree.valueOffsets) &&
+         (values == argOtherTree.values);
+}
+
+uint64_t FlatTree::GetHash() const {
+  auto hash = HashArray(FNV_OFFSET_BASIS, kinds);
+  hash = HashArray(hash, nameIds);
+  hash = HashArray(hash, unitAddressIds);
+  hash = HashArray(hash, parents);
+  hash = HashArray(hash, valueOffsets);
+  return HashBytes(hash, values.data(), values.size());
+}
+
+std::string_view FlatTree::GetValue(const Index argIndex) const {
+  return std::string_view{values}.substr(
+      valueOffsets[argIndex],
+      valueOffsets[argIndex + 1] - valueOffsets[argIndex]);
+}
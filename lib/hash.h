@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// 64 bit FNV-1a based hashing of item contents. Numbers are mixed in as
+// values rather than as bytes, so hashes do not depend on the host.
+
+constexpr uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325;
+constexpr uint64_t FNV_PRIME = 0x100000001b3;
+constexpr uint64_t WORD_MULTIPLIER = 0x9e3779b97f4a7c15;
+
+// Tags distinguishing the kinds of hashed items
+enum class HashTag : uint8_t {
+  NODE = 1,
+  PROPERTY_EMPTY,
+  PROPERTY_PHANDLE,
+  PROPERTY_STRING,
+  PROPERTY_STRING_LIST,
+  PROPERTY_U32,
+  PROPERTY_U64,
+  ROOT_NODE,
+};
+
+inline uint64_t HashBytes(uint64_t argHash, const void *argData,
+                          const std::size_t argSize) noexcept {
+  const auto bytes = static_cast<const unsigned char *>(argData);
+  for (std::size_t i = 0; i < argSize; ++i) {
+    argHash = (argHash ^ bytes[i]) * FNV_PRIME;
+  }
+  return argHash;
+}
+
+// Feed a whole number at once, which is considerably faster than doing it
+// byte-wise
+inline uint64_t HashNumber(uint64_t argHash,
+                           const uint64_t argNumber) noexcept {
+  argHash = (argHash ^ argNumber) * WORD_MULTIPLIER;
+  return argHash ^ (argHash >> 32);
+}
+
+// Scramble all bits of a number like the finalizer of SplitMix64, so that
+// numbers differing in few bits yield unrelated results
+constexpr uint64_t MixBits(uint64_t argNumber) noexcept {
+  argNumber = (argNumber ^ (argNumber >> 30)) * 0xbf58476d1ce4e5b9;
+  argNumber = (argNumber ^ (argNumber >> 27)) * 0x94d049bb133111eb;
+  return argNumber ^ (argNumber >> 31);
+}
+
+// Hash a string prefixed by its length, so that concatenations are unambiguous
+inline uint64_t HashString(const uint64_t argHash,
+                           const std::string_view argString) noexcept {
+  return HashBytes(HashNumber(argHash, argString.size()), argString.data(),
+                   argString.size());
+}
+
+#endif // HASH_H
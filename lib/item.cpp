@@ -21,27 +21,35 @@
  * SOFTWARE.
  */
 
+#include "output_sink.h"
 #include "property.h"
 #include "root_node.h"
 
 #include <exception>
 #include <iostream>
+#include <sstream>
 #include <stdexcept>
 
-class EmptyOrInvalSharedPtrItemException : public std::exception {
+class EmptyOrInvalidItemException : public std::exception {
   const char *what() const noexcept override;
 };
 
-const char *EmptyOrInvalSharedPtrItemException::what() const noexcept {
-  return "Encountered empty or invalid SharedPtrItem on copy attempt";
+const char *EmptyOrInvalidItemException::what() const noexcept {
+  return "Encountered empty or invalid Item on copy attempt";
 }
 
-class UnknownSharedPtrItemMemberTypeException : public std::exception {
+class UnknownItemTypeException : public std::exception {
   const char *what() const noexcept override;
 };
 
-const char *UnknownSharedPtrItemMemberTypeException::what() const noexcept {
-  return "Encountered unknown member type in SharedPtrItem";
+const char *UnknownItemTypeException::what() const noexcept {
+  return "Encountered unknown Item type on copy attempt";
+}
+
+template <typename T>
+static Item *CloneItemOfType(const Item *argItem, const Node *argParentNode) {
+  return argParentNode->GetArena().Create<T>(*static_cast<const T *>(argItem),
+                                             argParentNode);
 }
 
 Item::~Item() {}
@@ -55,7 +63,7 @@ bool Item::Compare(const Item *argOtherItem) const {
     return false;
   }
 
-  if ((level == argOtherItem->level) && (name == argOtherItem->name) &&
+  if ((level == argOtherItem->level) && (nameId == argOtherItem->nameId) &&
       (type == argOtherItem->type)) {
     return true;
   }
@@ -63,7 +71,14 @@ bool Item::Compare(const Item *argOtherItem) const {
   return false;
 }
 
-std::string Item::GetPrependedTabs() const { return std::string(level, '\t'); }
+std::string Item::GetStringRep() const {
+  std::ostringstream stringRepStream;
+  {
+    OutputSink outputSink{stringRepStream};
+    Serialize(outputSink);
+  }
+  return stringRepStream.str();
+}
 
 void Item::Merge(const Item *argOtherItem, bool argAddFromOther,
                  bool argPurgeItemsNotInOther) {
@@ -71,40 +86,46 @@ void Item::Merge(const Item *argOtherItem, bool argAddFromOther,
   (void)argPurgeItemsNotInOther;
 
   // Assure that the to be merged items are equal in terms of level and name
-  if ((level != argOtherItem->level) || (name != argOtherItem->name) ||
+  if ((level != argOtherItem->level) || (nameId != argOtherItem->nameId) ||
       (type != argOtherItem->type)) {
     throw std::invalid_argument{"Attempt to merge non-related Item instance"};
   }
 }
 
-void Item::Print() const { std::cout << GetStringRep() << "\n"; }
-
-Item::SharedPtrItem
-CopySharedPtrItem(const Item::SharedPtrConstItem &argSharedPtrConstItem) {
-  const auto itemPtr = dynamic_cast<const Item *>(argSharedPtrConstItem.get());
-
-  if (itemPtr == nullptr) {
-    throw EmptyOrInvalSharedPtrItemException{};
-  }
+void Item::Print(std::ostream &argOutputStream) const {
+  OutputSink outputSink{argOutputStream};
+  Serialize(outputSink);
+  outputSink.Append('\n');
+}
 
-  if (dynamic_cast<const Node *>(itemPtr)) {
-    return std::make_shared<Node>(*reinterpret_cast<const Node *>(itemPtr));
+Item *CloneItem(const Item *argItem, const Node *argParentNode) {
+  if ((argItem == nullptr) || (argParentNode == nullptr)) {
+    throw EmptyOrInvalidItemException{};
   }
 
-  if (dynamic_cast<const PropertyEmpty *>(itemPtr)) {
-    return std::make_shared<PropertyEmpty>(
-        *reinterpret_cast<const PropertyEmpty *>(itemPtr));
+  // Root nodes cannot be placed below another node
+  if (dynamic_cast<const RootNode *>(argItem)) {
+    throw EmptyOrInvalidItemException{};
   }
 
-  if (dynamic_cast<const PropertyValueString *>(itemPtr)) {
-    return std::make_shared<PropertyValueString>(
-        *reinterpret_cast<const PropertyValueString *>(itemPtr));
+  if (dynamic_cast<const Node *>(argItem)) {
+    return CloneItemOfType<Node>(argItem, argParentNode);
   }
 
-  if (dynamic_cast<const RootNode *>(itemPtr)) {
-    return std::make_shared<RootNode>(
-        *reinterpret_cast<const RootNode *>(itemPtr));
+  switch (static_cast<const Property *>(argItem)->GetValueType()) {
+  case Property::ValueType::EMPTY:
+    return CloneItemOfType<PropertyEmpty>(argItem, argParentNode);
+  case Property::ValueType::PHANDLE:
+    return CloneItemOfType<PropertyValuePHandle>(argItem, argParentNode);
+  case Property::ValueType::STRING:
+    return CloneItemOfType<PropertyValueString>(argItem, argParentNode);
+  case Property::ValueType::STRING_LIST:
+    return CloneItemOfType<PropertyValueStringList>(argItem, argParentNode);
+  case Property::ValueType::U32:
+    return CloneItemOfType<PropertyValueU32>(argItem, argParentNode);
+  case Property::ValueType::U64:
+    return CloneItemOfType<PropertyValueU64>(argItem, argParentNode);
   }
 
-  throw UnknownSharedPtrItemMemberTypeException{};
+  throw UnknownItemTypeException{};
 }
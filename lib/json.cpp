@@ -0,0 +1,345 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "json.h"
+
+#include <exception>
+
+void AppendEscapedJsonString(std::string &argOutput,
+                             const std::string_view argInputStr) {
+  constexpr char HEX_DIGITS[] = "0123456789abcdef";
+
+  for (const auto character : argInputStr) {
+    switch (character) {
+    case '"':
+      argOutput.append("\\\"");
+      break;
+    case '\\':
+      argOutput.append("\\\\");
+      break;
+    case '\n':
+      argOutput.append("\\n");
+      break;
+    case '\t':
+      argOutput.append("\\t");
+      break;
+    default:
+      if (static_cast<unsigned char>(character) < 0x20) {
+        argOutput.append("\\u00");
+        argOutput.push_back(HEX_DIGITS[(character >> 4) & 0xf]);
+        argOutput.push_back(HEX_DIGITS[character & 0xf]);
+      } else {
+        argOutput.push_back(character);
+      }
+    }
+  }
+}
+
+void AppendJsonString(std::string &argOutput,
+                      const std::string_view argInputStr) {
+  argOutput.push_back('"');
+  AppendEscapedJsonString(argOutput, argInputStr);
+  argOutput.push_back('"');
+}
+
+class InvalidJsonException : public std::exception {
+  const char *what() const noexcept override;
+};
+
+const char *InvalidJsonException::what() const noexcept {
+  return "Encountered invalid JSON on parsing";
+}
+
+// Nesting limit protecting the stack against malicious documents
+constexpr unsigned MAX_JSON_DEPTH = 512;
+
+static void SkipJsonWhitespace(std::string_view &argInput) {
+  while ((argInput.empty() == false) &&
+         ((argInput.front() == ' ') || (argInput.front() == '\t') ||
+          (argInput.front() == '\n') || (argInput.front() == '\r'))) {
+    argInput.remove_prefix(1);
+  }
+}
+
+static void ExpectJsonChar(std::string_view &argInput, const char argChar) {
+  SkipJsonWhitespace(argInput);
+  if (argInput.empty() || (argInput.front() != argChar)) {
+    throw InvalidJsonException{};
+  }
+  argInput.remove_prefix(1);
+}
+
+static unsigned ParseJsonHexDigits(std::string_view &argInput) {
+  if (argInput.size() < 4) {
+    throw InvalidJsonException{};
+  }
+  unsigned codePoint = 0;
+  for (auto i = 0; i < 4; ++i) {
+    const auto c = argInput[i];
+    codePoint <<= 4;
+    if ((c >= '0') && (c <= '9')) {
+      codePoint |= static_cast<unsigned>(c - '0');
+    } else if ((c >= 'a') && (c <= 'f')) {
+      codePoint |= static_cast<unsigned>(c - 'a' + 10);
+    } else if ((c >= 'A') && (c <= 'F')) {
+      codePoint |= static_cast<unsigned>(c - 'A' + 10);
+    } else {
+      throw InvalidJsonException{};
+    }
+  }
+  argInput.remove_prefix(4);
+  return codePoint;
+}
+
+static std::string ParseJsonString(std::string_view &argInput) {
+  ExpectJsonChar(argInput, '"');
+  std::string resultStr;
+  while (true) {
+    // Copy the characters up to the next quote or escape at once
+    const auto specialPos = argInput.find_first_of("\"\\");
+    if (specialPos == std::string_view::npos) {
+      throw InvalidJsonException{};
+    }
+    resultStr.append(argInput.substr(0, specialPos));
+    const auto special = argInput[specialPos];
+    argInput.remove_prefix(specialPos + 1);
+    if (special == '"') {
+      return resultStr;
+    }
+
+    if (argInput.empty()) {
+      throw InvalidJsonException{};
+    }
+    const auto escaped = argInput.front();
+    argInput.remove_prefix(1);
+    switch (escaped) {
+    case '"':
+    case '\\':
+    case '/':
+      resultStr.push_back(escaped);
+      break;
+    case 'b':
+      resultStr.push_back('\b');
+      break;
+    case 'f':
+      resultStr.push_back('\f');
+      break;
+    case 'n':
+      resultStr.push_back('\n');
+      break;
+    case 'r':
+      resultStr.push_back('\r');
+      break;
+    case 't':
+      resultStr.push_back('\t');
+      break;
+    case 'u': {
+      auto codePoint = ParseJsonHexDigits(argInput);
+      // Characters outside of the basic plane are given as surrogate pairs
+      if ((codePoint >= 0xd800) && (codePoint < 0xdc00) &&
+          (argInput.substr(0, 2) == "\\u")) {
+        argInput.remove_prefix(2);
+        const auto lowSurrogate = ParseJsonHexDigits(argInput);
+        codePoint =
+            0x10000 + ((codePoint - 0xd800) << 10) + (lowSurrogate - 0xdc00);
+      }
+      // Encode the code point as UTF-8
+      if (codePoint < 0x80) {
+        resultStr.push_back(static_cast<char>(codePoint));
+      } else if (codePoint < 0x800) {
+        resultStr.push_back(static_cast<char>(0xc0 | (codePoint >> 6)));
+        resultStr.push_back(static_cast<char>(0x80 | (codePoint & 0x3f)));
+      } else if (codePoint < 0x10000) {
+        resultStr.push_back(static_cast<char>(0xe0 | (codePoint >> 12)));
+        resultStr.push_back(
+            static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f)));
+        resultStr.push_back(static_cast<char>(0x80 | (codePoint & 0x3f)));
+      } else {
+        resultStr.push_back(static_cast<char>(0xf0 | (codePoint >> 18)));
+        resultStr.push_back(
+            static_cast<char>(0x80 | ((codePoint >> 12) & 0x3f)));
+        resultStr.push_back(
+            static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f)));
+        resultStr.push_back(static_cast<char>(0x80 | (codePoint & 0x3f)));
+      }
+      break;
+    }
+    default:
+      throw InvalidJsonException{};
+    }
+  }
+}
+
+// Recursive descent parsing of JSON values, advancing the input past them
+static JsonValue ParseJsonValue(std::string_view &argInput,
+                                const unsigned argDepth) {
+  if (argDepth > MAX_JSON_DEPTH) {
+    throw InvalidJsonException{};
+  }
+
+  SkipJsonWhitespace(argInput);
+  if (argInput.empty()) {
+    throw InvalidJsonException{};
+  }
+
+  JsonValue value;
+  switch (argInput.front()) {
+  case '{':
+    value.type = JsonValue::Type::OBJECT;
+    argInput.remove_prefix(1);
+    SkipJsonWhitespace(argInput);
+    if ((argInput.empty() == false) && (argInput.front() == '}')) {
+      argInput.remove_prefix(1);
+      return value;
+    }
+    while (true) {
+      auto name = ParseJsonString(argInput);
+      ExpectJsonChar(argInput, ':');
+      value.members.emplace_back(std::move(name),
+                                 ParseJsonValue(argInput, argDepth + 1));
+      SkipJsonWhitespace(argInput);
+      if ((argInput.empty() == false) && (argInput.front() == ',')) {
+        argInput.remove_prefix(1);
+        continue;
+      }
+      ExpectJsonChar(argInput, '}');
+      return value;
+    }
+  case '[':
+    value.type = JsonValue::Type::ARRAY;
+    argInput.remove_prefix(1);
+    SkipJsonWhitespace(argInput);
+    if ((argInput.empty() == false) && (argInput.front() == ']')) {
+      argInput.remove_prefix(1);
+      return value;
+    }
+    while (true) {
+      value.elements.emplace_back(ParseJsonValue(argInput, argDepth + 1));
+      SkipJsonWhitespace(argInput);
+      if ((argInput.empty() == false) && (argInput.front() == ',')) {
+        argInput.remove_prefix(1);
+        continue;
+      }
+      ExpectJsonChar(argInput, ']');
+      return value;
+    }
+  case '"':
+    value.type = JsonValue::Type::STRING;
+    value.text = ParseJsonString(argInput);
+    return value;
+  default:
+    break;
+  }
+
+  for (const auto &literal :
+       {std::make_pair(std::string_view{"false"}, JsonValue::Type::FALSE),
+        std::make_pair(std::string_view{"null"}, JsonValue::Type::NULL_VALUE),
+        std::make_pair(std::string_view{"true"}, JsonValue::Type::TRUE)}) {
+    if (argInput.substr(0, literal.first.size()) == literal.first) {
+      argInput.remove_prefix(literal.first.size());
+      value.type = literal.second;
+      return value;
+    }
+  }
+
+  // Numbers are only checked for consisting of valid characters
+  std::string_view::size_type numberLength = 0;
+  while ((numberLength < argInput.size()) &&
+         (std::string_view{"+-.0123456789Ee"}.find(argInput[numberLength]) !=
+          std::string_view::npos)) {
+    ++numberLength;
+  }
+  if (numberLength == 0) {
+    throw InvalidJsonException{};
+  }
+  value.type = JsonValue::Type::NUMBER;
+  value.text = argInput.substr(0, numberLength);
+  argInput.remove_prefix(numberLength);
+  return value;
+}
+
+void JsonReader::Finish() {
+  SkipJsonWhitespace(input);
+  if ((depth != 0) || (input.empty() == false)) {
+    throw InvalidJsonException{};
+  }
+}
+
+bool JsonReader::NextMember(std::string &argName) {
+  if (Next('}') == false) {
+    return false;
+  }
+  argName = ParseJsonString(input);
+  ExpectJsonChar(input, ':');
+  return true;
+}
+
+JsonValue::Type JsonReader::PeekType() {
+  SkipJsonWhitespace(input);
+  if (input.empty()) {
+    throw InvalidJsonException{};
+  }
+  switch (input.front()) {
+  case '[':
+    return JsonValue::Type::ARRAY;
+  case 'f':
+    return JsonValue::Type::FALSE;
+  case 'n':
+    return JsonValue::Type::NULL_VALUE;
+  case '{':
+    return JsonValue::Type::OBJECT;
+  case '"':
+    return JsonValue::Type::STRING;
+  case 't':
+    return JsonValue::Type::TRUE;
+  default:
+    return JsonValue::Type::NUMBER;
+  }
+}
+
+std::string JsonReader::ReadString() { return ParseJsonString(input); }
+
+JsonValue JsonReader::ReadValue() { return ParseJsonValue(input, depth); }
+
+void JsonReader::Begin(const char argOpeningChar) {
+  if (++depth > MAX_JSON_DEPTH) {
+    throw InvalidJsonException{};
+  }
+  ExpectJsonChar(input, argOpeningChar);
+  isAtFirstEntry = true;
+}
+
+bool JsonReader::Next(const char argClosingChar) {
+  SkipJsonWhitespace(input);
+  if ((input.empty() == false) && (input.front() == argClosingChar)) {
+    input.remove_prefix(1);
+    --depth;
+    isAtFirstEntry = false;
+    return false;
+  }
+  if (isAtFirstEntry == false) {
+    ExpectJsonChar(input, ',');
+  }
+  isAtFirstEntry = false;
+  return true;
+}
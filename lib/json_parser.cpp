@@ -0,0 +1,246 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "json_parser.h"
+#include "arena.h"
+#include "json.h"
+#include "mapped_file.h"
+#include "property.h"
+#include "root_node.h"
+#include "value_codec.h"
+
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <optional>
+
+class InvalidJsonTreeException : public std::exception {
+  const char *what() const noexcept override;
+};
+
+const char *InvalidJsonTreeException::what() const noexcept {
+  return "Encountered invalid structure on JSON device tree parsing";
+}
+
+// Append the cells of a "cells" or "cells64" array in device tree source
+// representation. References are only valid in 32 bit cells.
+template <typename T>
+static void AppendJsonCells(std::string &argOutput,
+                            const JsonValue &argCells) {
+  argOutput.push_back('<');
+  bool isFirstCell = true;
+  for (const auto &cell : argCells.elements) {
+    if (isFirstCell == false) {
+      argOutput.push_back(' ');
+    }
+    isFirstCell = false;
+    if ((sizeof(T) == sizeof(uint32_t)) &&
+        (cell.type == JsonValue::Type::STRING) && (cell.text.size() > 1) &&
+        (cell.text.front() == '&')) {
+      argOutput.append(cell.text);
+      continue;
+    }
+    if (cell.type != JsonValue::Type::NUMBER) {
+      throw InvalidJsonTreeException{};
+    }
+    T number = 0;
+    const auto textEnd = cell.text.data() + cell.text.size();
+    const auto result = std::from_chars(cell.text.data(), textEnd, number);
+    if ((result.ec != std::errc{}) || (result.ptr != textEnd)) {
+      throw InvalidJsonTreeException{};
+    }
+    AppendHexNumber(argOutput, number);
+  }
+  argOutput.push_back('>');
+}
+
+JsonParser::JsonParser(const std::string &argFilePath,
+                       std::ostream &argErrorStream)
+    : jsonFilePath{argFilePath}, errorStream{argErrorStream} {}
+
+JsonParser::~JsonParser() {}
+
+bool JsonParser::IsJsonFile(const std::string &argFilePath) {
+  std::ifstream inputFile{argFilePath, std::ios_base::binary};
+  char character = '\0';
+  while (inputFile.get(character)) {
+    if (std::isspace(static_cast<unsigned char>(character)) == 0) {
+      return character == '{';
+    }
+  }
+  return false;
+}
+
+std::unique_ptr<RootNode> JsonParser::ParseFile() {
+  const MappedFile mappedFile{jsonFilePath};
+  if (mappedFile.IsMapped() == false) {
+    errorStream << "Failed to map JSON file: " << jsonFilePath << "\n";
+    return nullptr;
+  }
+
+  JsonReader reader{mappedFile.GetView()};
+  std::string memberName;
+  if (reader.PeekType() != JsonValue::Type::OBJECT) {
+    throw InvalidJsonTreeException{};
+  }
+  reader.BeginObject();
+  if ((reader.NextMember(memberName) == false) || (memberName != "node") ||
+      (reader.PeekType() != JsonValue::Type::STRING) ||
+      (reader.ReadString() != "/")) {
+    throw InvalidJsonTreeException{};
+  }
+
+  std::unique_ptr<RootNode> rootNode{new RootNode{std::make_shared<Arena>()}};
+  ParseNodeMembers(reader, *rootNode);
+  reader.Finish();
+  return rootNode;
+}
+
+void JsonParser::ParseNodeMembers(JsonReader &argReader, Node &argNode) {
+  bool hasItems = false;
+  std::string memberName;
+  while (argReader.NextMember(memberName)) {
+    if (memberName == "label") {
+      if (argReader.PeekType() != JsonValue::Type::STRING) {
+        throw InvalidJsonTreeException{};
+      }
+      argNode.labelId = Node::InternLabel(argReader.ReadString());
+    } else if (memberName == "items") {
+      ParseNodeItems(argReader, argNode);
+      hasItems = true;
+    } else {
+      argReader.ReadValue();
+    }
+  }
+  if (hasItems == false) {
+    throw InvalidJsonTreeException{};
+  }
+
+  argNode.BuildChildIndex();
+  argNode.UpdateHash();
+}
+
+void JsonParser::ParseNodeItems(JsonReader &argReader, Node &argNode) {
+  if (argReader.PeekType() != JsonValue::Type::ARRAY) {
+    throw InvalidJsonTreeException{};
+  }
+  argReader.BeginArray();
+  std::string memberName;
+  while (argReader.NextElement()) {
+    if (argReader.PeekType() != JsonValue::Type::OBJECT) {
+      throw InvalidJsonTreeException{};
+    }
+    argReader.BeginObject();
+    if ((argReader.NextMember(memberName) == false) ||
+        (argReader.PeekType() != JsonValue::Type::STRING)) {
+      throw InvalidJsonTreeException{};
+    }
+    if (memberName == "property") {
+      ParseProperty(argReader, argNode);
+      continue;
+    }
+    if (memberName != "node") {
+      throw InvalidJsonTreeException{};
+    }
+
+    const auto nodeName = argReader.ReadString();
+    const auto atPos = nodeName.find('@');
+    auto &arena = argNode.GetArena();
+    const auto childNode = arena.Create<Node>(
+        std::string_view{nodeName}.substr(0, atPos),
+        atPos == std::string::npos
+            ? std::string_view{}
+            : std::string_view{nodeName}.substr(atPos + 1),
+        &argNode, arena);
+    ParseNodeMembers(argReader, *childNode);
+    argNode.items.emplace_back(childNode);
+  }
+}
+
+void JsonParser::ParseProperty(JsonReader &argReader, Node &argNode) {
+  const auto name = argReader.ReadString();
+
+  // Property values are small, so they are read completely
+  std::string type;
+  std::optional<JsonValue> jsonValue;
+  std::string memberName;
+  while (argReader.NextMember(memberName)) {
+    if (memberName == "type") {
+      if (argReader.PeekType() != JsonValue::Type::STRING) {
+        throw InvalidJsonTreeException{};
+      }
+      type = argReader.ReadString();
+    } else if (memberName == "value") {
+      jsonValue = argReader.ReadValue();
+    } else {
+      argReader.ReadValue();
+    }
+  }
+  const auto getValue = [&jsonValue](const JsonValue::Type argType)
+      -> const JsonValue & {
+    if ((jsonValue.has_value() == false) || (jsonValue->type != argType)) {
+      throw InvalidJsonTreeException{};
+    }
+    return *jsonValue;
+  };
+
+  std::optional<std::string> value;
+  if (type == "cells") {
+    value.emplace();
+    AppendJsonCells<uint32_t>(*value, getValue(JsonValue::Type::ARRAY));
+  } else if (type == "cells64") {
+    value.emplace("/bits/ 64 ");
+    AppendJsonCells<uint64_t>(*value, getValue(JsonValue::Type::ARRAY));
+  } else if (type == "strings") {
+    const auto &strings = getValue(JsonValue::Type::ARRAY);
+    if (strings.elements.empty()) {
+      throw InvalidJsonTreeException{};
+    }
+    // Quote the strings like they are stored, each one null-terminated
+    std::string joinedStrings;
+    for (const auto &string : strings.elements) {
+      if (string.type != JsonValue::Type::STRING) {
+        throw InvalidJsonTreeException{};
+      }
+      joinedStrings.append(string.text);
+      joinedStrings.push_back('\0');
+    }
+    value.emplace();
+    AppendQuotedStrings(*value, joinedStrings);
+  } else if (type == "source") {
+    value = getValue(JsonValue::Type::STRING).text;
+  } else if (type != "empty") {
+    throw InvalidJsonTreeException{};
+  }
+
+  if (value) {
+    argNode.items.emplace_back(
+        Property::Construct(name, std::string_view{*value}, &argNode));
+  } else {
+    argNode.items.emplace_back(
+        Property::Construct(name, std::nullopt, &argNode));
+  }
+}
@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "json_writer.h"
+#include "json.h"
+#include "name_pool.h"
+#include "output_sink.h"
+#include "property.h"
+#include "root_node.h"
+
+#include <charconv>
+#include <cstdint>
+
+// Append a number in decimal representation without any temporary string
+static void AppendJsonNumber(std::string &argOutput,
+                             const uint64_t argNumber) {
+  char digits[20];
+  const auto result = std::to_chars(std::begin(digits), std::end(digits),
+                                    argNumber);
+  argOutput.append(digits, result.ptr);
+}
+
+// Append the node's name with its unit address as JSON string
+static void AppendJsonNodeName(std::string &argOutput, const Node &argNode) {
+  const auto &namePool = NamePool::GetInstance();
+  argOutput.push_back('"');
+  AppendEscapedJsonString(argOutput, namePool.GetName(argNode.GetNameId()));
+  if (argNode.GetUnitAddressId() != NamePool::EMPTY_NAME_ID) {
+    argOutput.push_back('@');
+    AppendEscapedJsonString(argOutput, argNode.GetUnitAddress());
+  }
+  argOutput.push_back('"');
+}
+
+JsonWriter::JsonWriter(std::ostream &argOutputStream, const Format argFormat)
+    : outputStream{argOutputStream}, format{argFormat} {}
+
+void JsonWriter::Write(const RootNode &argRootNode) {
+  OutputSink outputSink{outputStream};
+  if (format == Format::DOCUMENT) {
+    WriteNode(outputSink, argRootNode);
+    outputSink.Append('\n');
+    return;
+  }
+
+  std::string path{"/"};
+  WriteNodeLines(outputSink, argRootNode, path);
+}
+
+void JsonWriter::WriteNode(OutputSink &argOutputSink, const Node &argNode) {
+  auto &buffer = argOutputSink.GetBuffer();
+  buffer.append("{\"node\":");
+  AppendJsonNodeName(buffer, argNode);
+  if (argNode.GetLabelId() != NamePool::EMPTY_NAME_ID) {
+    buffer.append(",\"label\":");
+    AppendJsonString(buffer, argNode.GetLabel());
+  }
+  argOutputSink.Append(",\"items\":[");
+
+  bool isFirstItem = true;
+  for (const auto item : argNode.GetItems()) {
+    if (isFirstItem == false) {
+      argOutputSink.Append(',');
+    }
+    isFirstItem = false;
+    if (item->GetType() == Item::Type::NODE) {
+      WriteNode(argOutputSink, *static_cast<const Node *>(item));
+    } else {
+      WriteProperty(argOutputSink, *static_cast<const Property *>(item));
+    }
+  }
+  argOutputSink.Append("]}");
+}
+
+void JsonWriter::WriteNodeLines(OutputSink &argOutputSink,
+                                const Node &argNode, std::string &argPath) {
+  auto &buffer = argOutputSink.GetBuffer();
+  buffer.append("{\"path\":");
+  AppendJsonString(buffer, argPath);
+  if (argNode.GetLabelId() != NamePool::EMPTY_NAME_ID) {
+    buffer.append(",\"label\":");
+    AppendJsonString(buffer, argNode.GetLabel());
+  }
+  argOutputSink.Append(",\"properties\":[");
+
+  bool isFirstProperty = true;
+  for (const auto item : argNode.GetItems()) {
+    if (item->GetType() == Item::Type::NODE) {
+      continue;
+    }
+    if (isFirstProperty == false) {
+      argOutputSink.Append(',');
+    }
+    isFirstProperty = false;
+    WriteProperty(argOutputSink, *static_cast<const Property *>(item));
+  }
+  argOutputSink.Append("]}\n");
+
+  // The child nodes' paths are appended to the node's one and cut off again
+  const auto &namePool = NamePool::GetInstance();
+  const auto pathSize = argPath.size();
+  for (const auto item : argNode.GetItems()) {
+    if (item->GetType() != Item::Type::NODE) {
+      continue;
+    }
+    const auto &childNode = *static_cast<const Node *>(item);
+    if (pathSize != 1) {
+      argPath.push_back('/');
+    }
+    argPath.append(namePool.GetName(childNode.GetNameId()));
+    if (childNode.GetUnitAddressId() != NamePool::EMPTY_NAME_ID) {
+      argPath.push_back('@');
+      argPath.append(childNode.GetUnitAddress());
+    }
+    WriteNodeLines(argOutputSink, childNode, argPath);
+    argPath.resize(pathSize);
+  }
+}
+
+void JsonWriter::WriteProperty(OutputSink &argOutputSink,
+                               const Property &argProperty) {
+  auto &buffer = argOutputSink.GetBuffer();
+  buffer.append("{\"property\":");
+  AppendJsonString(buffer,
+                   NamePool::GetInstance().GetName(argProperty.GetNameId()));
+
+  switch (argProperty.GetValueType()) {
+  case Property::ValueType::EMPTY:
+    buffer.append(",\"type\":\"empty\"");
+    break;
+  case Property::ValueType::PHANDLE: {
+    // References are exported as "&label" strings in place of their cells
+    buffer.append(",\"type\":\"cells\",\"value\":[");
+    const auto &property =
+        static_cast<const PropertyValuePHandle &>(argProperty);
+    const auto &cells = property.GetCells();
+    const auto &references = property.GetReferences();
+    std::pmr::vector<PropertyValuePHandle::Reference>::size_type
+        nextReference = 0;
+    for (std::pmr::vector<uint32_t>::size_type i = 0; i < cells.size(); ++i) {
+      if (i != 0) {
+        buffer.push_back(',');
+      }
+      if ((nextReference < references.size()) &&
+          (references[nextReference].cellIndex == i)) {
+        buffer.append("\"&");
+        AppendEscapedJsonString(buffer, references[nextReference].label);
+        buffer.push_back('"');
+        ++nextReference;
+        continue;
+      }
+      AppendJsonNumber(buffer, cells[i]);
+    }
+    buffer.push_back(']');
+    break;
+  }
+  case Property::ValueType::STRING:
+    // Values without typed representation are kept as their source text
+    buffer.append(",\"type\":\"source\",\"value\":");
+    AppendJsonString(
+        buffer,
+        static_cast<const PropertyValueString &>(argProperty).GetValue());
+    break;
+  case Property::ValueType::STRING_LIST: {
+    buffer.append(",\"type\":\"strings\",\"value\":[");
+    bool isFirstString = true;
+    for (const auto string :
+         static_cast<const PropertyValueStringList &>(argProperty)
+             .GetStrings()) {
+      if (isFirstString == false) {
+        buffer.push_back(',');
+      }
+      isFirstString = false;
+      AppendJsonString(buffer, string);
+    }
+    buffer.push_back(']');
+    break;
+  }
+  case Property::ValueType::U32: {
+    buffer.append(",\"type\":\"cells\",\"value\":[");
+    const auto &cells =
+        static_cast<const PropertyValueU32 &>(argProperty).GetCells();
+    for (std::pmr::vector<uint32_t>::size_type i = 0; i < cells.size(); ++i) {
+      if (i != 0) {
+        buffer.push_back(',');
+      }
+      AppendJsonNumber(buffer, cells[i]);
+    }
+    buffer.push_back(']');
+    break;
+  }
+  case Property::ValueType::U64: {
+    buffer.append(",\"type\":\"cells64\",\"value\":[");
+    const auto &cells =
+        static_cast<const PropertyValueU64 &>(argProperty).GetCells();
+    for (std::pmr::vector<uint64_t>::size_type i = 0; i < cells.size(); ++i) {
+      if (i != 0) {
+        buffer.push_back(',');
+      }
+      AppendJsonNumber(buffer, cells[i]);
+    }
+    buffer.push_back(']');
+    break;
+  }
+  }
+  argOutputSink.Append('}');
+}
@@ -22,6 +22,7 @@
  */
 
 #include "label.h"
+#include "lexer.h"
 
 #include <exception>
 
@@ -33,15 +34,12 @@ const char *InvalidLabelException::what() const noexcept {
   return "Encountered invalid label on device tree parsing";
 }
 
-constexpr auto VALID_LABEL_CHARS =
-    "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_";
-
-void Label::VerifyLabel(const std::string &argLabel) {
+void Label::VerifyLabel(const std::string_view argLabel) {
   if ((argLabel.size() < 1) || (argLabel.size() > 31)) {
     throw InvalidLabelException{};
   }
 
-  if (argLabel.find_first_not_of(VALID_LABEL_CHARS) != std::string::npos) {
+  if (ConsistsOfCharClass(argLabel, CharClass::LABEL) == false) {
     throw InvalidLabelException{};
   }
 }
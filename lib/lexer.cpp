@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "lexer.h"
+
+constexpr std::string_view VALUE_DIVIDER = " = ";
+
+bool ScanPropertyLine(const std::string_view argLine,
+                      PropertyToken &argToken) {
+  // A property line is indented by at least one tab ...
+  std::string_view::size_type pos = 0;
+  while ((pos < argLine.size()) && (argLine[pos] == '\t')) {
+    ++pos;
+  }
+  if (pos == 0) {
+    return false;
+  }
+
+  // ... followed by a non-empty property name ...
+  const auto nameLength =
+      ScanCharClass(argLine.substr(pos), CharClass::PROPERTY_NAME);
+  if (nameLength == 0) {
+    return false;
+  }
+  argToken.name = argLine.substr(pos, nameLength);
+  pos += nameLength;
+
+  // ... which is terminated either by a semicolon ...
+  const auto remainder = argLine.substr(pos);
+  if ((remainder.empty() == false) && (remainder.front() == ';')) {
+    argToken.value = {};
+    argToken.hasValue = false;
+    return true;
+  }
+
+  // ... or by the divider between property name and value
+  if (remainder.substr(0, VALUE_DIVIDER.size()) != VALUE_DIVIDER) {
+    return false;
+  }
+  auto value = remainder.substr(VALUE_DIVIDER.size());
+
+  // The value has to be terminated by a semicolon, which is stripped together
+  // with the whitespace around it
+  const auto semicolonPos = value.find_last_not_of(" \t\r");
+  if ((semicolonPos == std::string_view::npos) ||
+      (value[semicolonPos] != ';')) {
+    return false;
+  }
+  value = value.substr(0, semicolonPos);
+  const auto valueEnd = value.find_last_not_of(" \t\r");
+  value = (valueEnd == std::string_view::npos) ? std::string_view{}
+                                               : value.substr(0, valueEnd + 1);
+  argToken.value = value;
+  argToken.hasValue = true;
+
+  return true;
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+// Character classes of the identifiers which can occur in device tree sources
+enum class CharClass : uint8_t {
+  LABEL = 0x01,
+  NODE_NAME = 0x02,
+  PROPERTY_NAME = 0x04,
+};
+
+constexpr auto VALID_LABEL_CHARS =
+    "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_";
+constexpr auto VALID_NODE_NAME_CHARS =
+    "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ,._+-";
+constexpr auto VALID_PROPERTY_NAME_CHARS =
+    "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ,._+?#-";
+
+constexpr std::array<uint8_t, 256> MakeCharClassTable() {
+  std::array<uint8_t, 256> table{};
+  const std::array<std::pair<const char *, CharClass>, 3> classes{
+      {{VALID_LABEL_CHARS, CharClass::LABEL},
+       {VALID_NODE_NAME_CHARS, CharClass::NODE_NAME},
+       {VALID_PROPERTY_NAME_CHARS, CharClass::PROPERTY_NAME}}};
+  for (const auto &charClass : classes) {
+    for (auto c = charClass.first; *c != '\0'; ++c) {
+      table[static_cast<unsigned char>(*c)] |=
+          static_cast<uint8_t>(charClass.second);
+    }
+  }
+  return table;
+}
+
+constexpr std::array<uint8_t, 256> CHAR_CLASS_TABLE = MakeCharClassTable();
+
+constexpr bool IsOfCharClass(const char argChar,
+                             const CharClass argCharClass) noexcept {
+  return (CHAR_CLASS_TABLE[static_cast<unsigned char>(argChar)] &
+          static_cast<uint8_t>(argCharClass)) != 0;
+}
+
+// Return the length of the prefix of the input consisting only of characters
+// of the given class
+constexpr std::string_view::size_type
+ScanCharClass(const std::string_view argInput,
+              const CharClass argCharClass) noexcept {
+  std::string_view::size_type length = 0;
+  while ((length < argInput.size()) &&
+         IsOfCharClass(argInput[length], argCharClass)) {
+    ++length;
+  }
+  return length;
+}
+
+constexpr bool ConsistsOfCharClass(const std::string_view argInput,
+                                   const CharClass argCharClass) noexcept {
+  return ScanCharClass(argInput, argCharClass) == argInput.size();
+}
+
+struct PropertyToken {
+  std::string_view name;
+  std::string_view value;
+  bool hasValue = false;
+};
+
+bool ScanPropertyLine(std::string_view argLine, PropertyToken &argToken);
+
+#endif // LEXER_H
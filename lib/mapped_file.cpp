@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string &argFilePath) {
+  const auto fd = open(argFilePath.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return;
+  }
+
+  // Only regular files of non-zero size can be mapped
+  struct stat fileStat {};
+  if ((fstat(fd, &fileStat) != 0) || (S_ISREG(fileStat.st_mode) == false) ||
+      (fileStat.st_size <= 0)) {
+    close(fd);
+    return;
+  }
+
+  const auto fileSize = static_cast<std::size_t>(fileStat.st_size);
+  const auto mapping = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping stays valid after the file descriptor has been closed
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    return;
+  }
+
+  // The file is scanned from front to back exactly once
+  madvise(mapping, fileSize, MADV_SEQUENTIAL);
+
+  data = mapping;
+  size = fileSize;
+}
+
+MappedFile::MappedFile(MappedFile &&argMappedFile) noexcept
+    : data{argMappedFile.data}, size{argMappedFile.size} {
+  argMappedFile.data = nullptr;
+  argMappedFile.size = 0;
+}
+
+MappedFile::~MappedFile() {
+  if (data != nullptr) {
+    munmap(data, size);
+  }
+}
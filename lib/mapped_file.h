@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Read-only memory mapping of a whole file which is unmapped on destruction
+class MappedFile {
+public:
+  MappedFile(const std::string &argFilePath);
+  MappedFile(const MappedFile &argMappedFile) = delete;
+  MappedFile(MappedFile &&argMappedFile) noexcept;
+  ~MappedFile();
+
+  MappedFile &operator=(const MappedFile &argMappedFile) = delete;
+  MappedFile &operator=(MappedFile &&argMappedFile) = delete;
+
+  std::string_view GetView() const noexcept {
+    return {static_cast<const char *>(data), size};
+  }
+  bool IsMapped() const noexcept { return data != nullptr; }
+
+private:
+  void *data = nullptr;
+  std::size_t size = 0;
+};
+
+#endif // MAPPED_FILE_H
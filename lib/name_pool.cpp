@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "name_pool.h"
+
+#include <stdexcept>
+
+NamePool::NamePool() {
+  // The empty name is always present with a well-known ID
+  Intern({});
+}
+
+NamePool &NamePool::GetInstance() {
+  static NamePool namePool;
+  return namePool;
+}
+
+NamePool::NameId NamePool::Intern(const std::string_view argName) {
+  {
+    const std::shared_lock<std::shared_mutex> lock{mutex};
+    const auto nameIdIt = nameIds.find(argName);
+    if (nameIdIt != nameIds.end()) {
+      return nameIdIt->second;
+    }
+  }
+
+  const std::unique_lock<std::shared_mutex> lock{mutex};
+  // Another thread might have interned the name in the meantime
+  const auto nameIdIt = nameIds.find(argName);
+  if (nameIdIt != nameIds.end()) {
+    return nameIdIt->second;
+  }
+
+  const auto chunkIdx = nameQty / CHUNK_SIZE;
+  if (chunkIdx >= MAX_CHUNK_QTY) {
+    throw std::length_error{"Exceeded the capacity of the name pool"};
+  }
+  if (ownedChunks[chunkIdx] == nullptr) {
+    ownedChunks[chunkIdx] = std::make_unique<std::string[]>(CHUNK_SIZE);
+    chunks[chunkIdx].store(ownedChunks[chunkIdx].get(),
+                           std::memory_order_release);
+  }
+
+  const auto nameId = nameQty++;
+  auto &internedName = ownedChunks[chunkIdx][nameId % CHUNK_SIZE];
+  internedName.assign(argName);
+  nameIds.emplace(internedName, nameId);
+  return nameId;
+}
@@ -22,12 +22,21 @@
  */
 
 #include "node.h"
+#include "arena.h"
+#include "hash.h"
+#include "label.h"
+#include "lexer.h"
+#include "line_reader.h"
+#include "output_sink.h"
 #include "property.h"
 #include "string_utils.h"
 
 #include <algorithm>
 #include <exception>
 #include <iostream>
+#include <stdexcept>
+#include <tuple>
+#include <typeinfo>
 
 class InvalidNodeNameException : public std::exception {
   const char *what() const noexcept override;
@@ -37,27 +46,37 @@ const char *InvalidNodeNameException::what() const noexcept {
   return "Encountered invalid node name on device tree parsing";
 }
 
-constexpr std::string::size_type MAXIMUM_NODE_NAME_LENGTH = 31;
-constexpr std::string::size_type MINIMUM_NODE_NAME_LENGTH = 1;
-constexpr auto VALID_NODE_NAME_CHARS =
-    "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ,._+-";
+constexpr std::string_view::size_type MAXIMUM_NODE_NAME_LENGTH = 31;
+constexpr std::string_view::size_type MINIMUM_NODE_NAME_LENGTH = 1;
 
-Node::Node(const std::string &argLine, std::istringstream &argInStream,
-           const Node *argParentNode)
+// The root node outlives the arenas of its tree, so its own item list must not
+// be allocated from them
+static std::pmr::memory_resource *
+GetItemsResource(const Node *const argParentNode, Arena &argArena) {
+  return argParentNode ? argArena.GetResource()
+                       : std::pmr::get_default_resource();
+}
+
+Node::Node(const std::string_view argLine, LineReader &argLineReader,
+           const Node *argParentNode, Arena &argArena)
     : Item{argParentNode
                ? static_cast<uint_fast16_t>(argParentNode->GetLevel() + 1)
                : static_cast<uint_fast16_t>(0u),
-           VerifyNodeName(argParentNode == nullptr,
-                          ExtractNodeName(argLine).nodeName),
+           NamePool::GetInstance().Intern(VerifyNodeName(
+               argParentNode == nullptr, ExtractNodeName(argLine).nodeName)),
+           NamePool::GetInstance().Intern(ExtractNodeName(argLine).unitAddress),
            argParentNode, argParentNode ? Type::NODE : Type::ROOT_NODE},
-      unitAddress{ExtractNodeName(argLine).unitAddress} {
-  std::string line;
-  while (std::getline(argInStream, line)) {
+      arena{argArena}, items{GetItemsResource(argParentNode, argArena)},
+      childIndex{GetItemsResource(argParentNode, argArena)},
+      labelId{InternLabel(ExtractNodeName(argLine).label)} {
+  std::string_view line;
+  while (argLineReader.GetLine(line)) {
     if (RemoveLeadingWhitespace(line).empty()) {
       continue;
     }
     if (Node::IsNodeStartLine(line)) {
-      items.emplace_back(new Node{line, argInStream, this});
+      items.emplace_back(
+          arena.Create<Node>(line, argLineReader, this, arena));
       continue;
     }
     if (Node::IsNodeEndLine(line)) {
@@ -65,11 +84,49 @@ Node::Node(const std::string &argLine, std::istringstream &argInStream,
     }
     items.emplace_back(Property::Construct(line, this));
   }
+  BuildChildIndex();
+  UpdateHash();
+}
+
+Node::Node(const std::string_view argName,
+           const std::string_view argUnitAddress, const Node *argParentNode,
+           Arena &argArena)
+    : Node{NamePool::GetInstance().Intern(
+               VerifyNodeName(argParentNode == nullptr, argName)),
+           NamePool::GetInstance().Intern(argUnitAddress), argParentNode,
+           argArena} {}
+
+Node::Node(const NamePool::NameId argNameId,
+           const NamePool::NameId argUnitAddressId, const Node *argParentNode,
+           Arena &argArena)
+    : Item{argParentNode
+               ? static_cast<uint_fast16_t>(argParentNode->GetLevel() + 1)
+               : static_cast<uint_fast16_t>(0u),
+           argNameId, argUnitAddressId, argParentNode,
+           argParentNode ? Type::NODE : Type::ROOT_NODE},
+      arena{argArena}, items{GetItemsResource(argParentNode, argArena)},
+      childIndex{GetItemsResource(argParentNode, argArena)} {}
+
+Node::Node(const Node &argNode, const Node *argParentNode)
+    : Item{argNode, argParentNode}, arena{argParentNode->GetArena()},
+      items{arena.GetResource()},
+      childIndex{argNode.childIndex, arena.GetResource()}, hash{argNode.hash},
+      subtreeSize{argNode.subtreeSize}, labelId{argNode.labelId},
+      hasDuplicateNames{argNode.hasDuplicateNames} {
+  items.reserve(argNode.items.size());
+  for (const auto item : argNode.items) {
+    items.emplace_back(CloneItem(item, this));
+  }
 }
 
-Node::Node(const Node &argNode) : Item{argNode} {
-  for (const auto &sharedPtrItem : argNode.items) {
-    items.emplace_back(CopySharedPtrItem(sharedPtrItem));
+Node::Node(const Node &argNode, const Node *argParentNode, ShareItems)
+    : Item{argNode, argParentNode}, arena{argParentNode->GetArena()},
+      items{argNode.items, arena.GetResource()},
+      childIndex{argNode.childIndex, arena.GetResource()}, hash{argNode.hash},
+      subtreeSize{argNode.subtreeSize}, labelId{argNode.labelId},
+      hasDuplicateNames{argNode.hasDuplicateNames} {
+  for (const auto item : items) {
+    item->shared = true;
   }
 }
 
@@ -83,26 +140,43 @@ bool Node::Compare(const Item *argOtherItem) const {
     return false;
   }
 
-  if (unitAddress != otherNode->GetUnitAddress()) {
+  return (unitAddressId == otherNode->unitAddressId) &&
+         (hash == otherNode->hash);
+}
+
+bool Node::CompareVerified(const Item *argOtherItem) const {
+  if (Compare(argOtherItem) == false) {
     return false;
   }
 
+  // Only items of the same name can be equal, so candidates are looked up via
+  // the child index
+  const auto hasEquivalent = [](const Item *const argItem,
+                                const Node &argNode) {
+    const auto candidates = argNode.FindChildKeys(
+        argItem->GetNameId(), argItem->GetUnitAddressId());
+    return std::any_of(
+        candidates.first, candidates.second,
+        [&argItem, &argNode](const ChildKey &argKey) {
+          const auto candidate = argNode.items[argKey.position];
+          if (argItem->GetType() == Type::PROPERTY) {
+            return argItem->Compare(candidate);
+          }
+          return static_cast<const Node *>(argItem)->CompareVerified(candidate);
+        });
+  };
+
   // Check that all items of this node have equivalents in the other node
-  for (const auto &item : items) {
-    if (std::find_if(std::begin(otherNode->items), std::end(otherNode->items),
-                     [&item](const SharedPtrItem &argSharedPtrItem) {
-                       return item->Compare(argSharedPtrItem.get());
-                     }) == std::end(otherNode->items)) {
+  const auto &otherNode = *static_cast<const Node *>(argOtherItem);
+  for (const auto item : items) {
+    if (hasEquivalent(item, otherNode) == false) {
       return false;
     }
   }
 
   // Check that all items of the other node have equivalents in this node
-  for (const auto &item : otherNode->items) {
-    if (std::find_if(std::begin(items), std::end(items),
-                     [&item](const SharedPtrItem &argSharedPtrItem) {
-                       return item->Compare(argSharedPtrItem.get());
-                     }) == std::end(items)) {
+  for (const auto item : otherNode.items) {
+    if (hasEquivalent(item, *this) == false) {
       return false;
     }
   }
@@ -110,58 +184,208 @@ bool Node::Compare(const Item *argOtherItem) const {
   return true;
 }
 
+const Item *Node::FindItem(const NamePool::NameId argNameId,
+                           const NamePool::NameId argUnitAddressId) const {
+  const auto keys = FindChildKeys(argNameId, argUnitAddressId);
+  if (keys.first == keys.second) {
+    return nullptr;
+  }
+  return items[keys.first->position];
+}
+
+const Item *Node::FindItem(const NamePool::NameId argNameId,
+                           const NamePool::NameId argUnitAddressId,
+                           const bool argIsProperty) const {
+  const auto keys = FindChildKeys(argNameId, argUnitAddressId);
+  for (auto it = keys.first; it != keys.second; ++it) {
+    const auto item = items[it->position];
+    if ((item->GetType() == Type::PROPERTY) == argIsProperty) {
+      return item;
+    }
+  }
+  return nullptr;
+}
+
+void Node::BuildChildIndex() {
+  childIndex.clear();
+  childIndex.reserve(items.size());
+  for (uint32_t position = 0; position < items.size(); ++position) {
+    childIndex.push_back({items[position]->GetNameId(),
+                          items[position]->GetUnitAddressId(), position});
+  }
+  std::sort(std::begin(childIndex), std::end(childIndex),
+            [](const ChildKey &argLhs, const ChildKey &argRhs) {
+              return std::tie(argLhs.nameId, argLhs.unitAddressId,
+                              argLhs.position) <
+                     std::tie(argRhs.nameId, argRhs.unitAddressId,
+                              argRhs.position);
+            });
+}
+
+void Node::UpdateHash() {
+  // Items are combined by adding up their hashes, which does not depend on
+  // their order. Items which compare equal to each other only count once like
+  // on comparison. Such items have the same name, so only items of the same
+  // run of the child index need to be checked.
+  uint64_t itemHashSum = 0;
+  uint32_t newSubtreeSize = 1;
+  bool newHasDuplicateNames = false;
+  auto runStart = std::begin(childIndex);
+  while (runStart != std::end(childIndex)) {
+    auto runEnd = runStart + 1;
+    while ((runEnd != std::end(childIndex)) &&
+           (runEnd->nameId == runStart->nameId) &&
+           (runEnd->unitAddressId == runStart->unitAddressId)) {
+      ++runEnd;
+    }
+    if (runEnd - runStart > 1) {
+      newHasDuplicateNames = true;
+    }
+    for (auto key = runStart; key != runEnd; ++key) {
+      const auto item = items[key->position];
+      if (item->GetType() == Type::PROPERTY) {
+        ++newSubtreeSize;
+      } else {
+        const auto childNode = static_cast<const Node *>(item);
+        newSubtreeSize += childNode->subtreeSize;
+        newHasDuplicateNames |= childNode->hasDuplicateNames;
+      }
+      const auto itemHash = item->GetHash();
+      const auto isDuplicate =
+          std::any_of(runStart, key, [this, itemHash](const ChildKey &argKey) {
+            return items[argKey.position]->GetHash() == itemHash;
+          });
+      if (isDuplicate == false) {
+        itemHashSum += HashNumber(FNV_OFFSET_BASIS, itemHash);
+      }
+    }
+    runStart = runEnd;
+  }
+
+  const auto &namePool = NamePool::GetInstance();
+  const auto tag = type == Type::ROOT_NODE ? HashTag::ROOT_NODE : HashTag::NODE;
+  auto newHash = HashNumber(FNV_OFFSET_BASIS, static_cast<uint64_t>(tag));
+  newHash = HashString(newHash, namePool.GetName(nameId));
+  newHash = HashString(newHash, namePool.GetName(unitAddressId));
+  hash = HashNumber(newHash, itemHashSum);
+  subtreeSize = newSubtreeSize;
+  hasDuplicateNames = newHasDuplicateNames;
+}
+
+std::pair<Node::ChildKeyIterator, Node::ChildKeyIterator>
+Node::FindChildKeys(const NamePool::NameId argNameId,
+                    const NamePool::NameId argUnitAddressId) const {
+  return std::equal_range(
+      std::begin(childIndex), std::end(childIndex),
+      ChildKey{argNameId, argUnitAddressId, 0},
+      [](const ChildKey &argLhs, const ChildKey &argRhs) {
+        return std::tie(argLhs.nameId, argLhs.unitAddressId) <
+               std::tie(argRhs.nameId, argRhs.unitAddressId);
+      });
+}
+
+Item **Node::FindItemSlot(const NamePool::NameId argNameId,
+                          const NamePool::NameId argUnitAddressId,
+                          const bool argIsProperty) {
+  const auto childKeys = FindChildKeys(argNameId, argUnitAddressId);
+  for (auto it = childKeys.first; it != childKeys.second; ++it) {
+    const auto item = items[it->position];
+    if ((item != nullptr) &&
+        ((item->GetType() == Type::PROPERTY) == argIsProperty)) {
+      return &items[it->position];
+    }
+  }
+  return nullptr;
+}
+
 std::string Node::GetDevicePath() const {
   // The root node only returns its name
-  if (name == "/") {
+  if (type == Type::ROOT_NODE) {
     return "/";
   }
-  // Direct children of the root node append their name to it
-  if (level == 1) {
-    return reinterpret_cast<const Node *>(parent)->GetDevicePath() + GetName();
+
+  // Size the path first and fill it in from its end while walking up to the
+  // root node again, preceding each node's name by a slash
+  const auto &namePool = NamePool::GetInstance();
+  std::string::size_type pathSize = 0;
+  for (auto node = this; node->type != Type::ROOT_NODE;
+       node = static_cast<const Node *>(node->parent)) {
+    pathSize += 1 + namePool.GetName(node->nameId).size();
+    if (node->unitAddressId != NamePool::EMPTY_NAME_ID) {
+      pathSize += 1 + namePool.GetName(node->unitAddressId).size();
+    }
+  }
+  std::string path(pathSize, '/');
+  auto pathEnd = pathSize;
+  for (auto node = this; node->type != Type::ROOT_NODE;
+       node = static_cast<const Node *>(node->parent)) {
+    if (node->unitAddressId != NamePool::EMPTY_NAME_ID) {
+      const auto &unitAddress = namePool.GetName(node->unitAddressId);
+      pathEnd -= unitAddress.size();
+      path.replace(pathEnd, unitAddress.size(), unitAddress);
+      path[--pathEnd] = '@';
+    }
+    const auto &name = namePool.GetName(node->nameId);
+    pathEnd -= name.size();
+    path.replace(pathEnd, name.size(), name);
+    --pathEnd;
   }
-  // Indirect children need to explicitly add a slash
-  return reinterpret_cast<const Node *>(parent)->GetDevicePath() + "/" +
-         GetName();
+  return path;
 }
 
 std::string Node::GetName() const {
-  return name + (unitAddress.empty() ? "" : "@" + unitAddress);
+  const auto &namePool = NamePool::GetInstance();
+  if (unitAddressId == NamePool::EMPTY_NAME_ID) {
+    return namePool.GetName(nameId);
+  }
+  return namePool.GetName(nameId) + "@" + namePool.GetName(unitAddressId);
 }
 
-std::string Node::GetStringRep() const {
-  std::string resultStr;
-  resultStr.append(GetPrependedTabs() + name + " {\n");
+void Node::Serialize(OutputSink &argOutputSink) const {
+  const auto &namePool = NamePool::GetInstance();
+  argOutputSink.AppendTabs(level);
+  if (labelId != NamePool::EMPTY_NAME_ID) {
+    argOutputSink.Append(namePool.GetName(labelId));
+    argOutputSink.Append(": ");
+  }
+  argOutputSink.Append(namePool.GetName(nameId));
+  if (unitAddressId != NamePool::EMPTY_NAME_ID) {
+    argOutputSink.Append('@');
+    argOutputSink.Append(namePool.GetName(unitAddressId));
+  }
+  argOutputSink.Append(" {\n");
   for (auto cit = items.cbegin(); cit != items.cend(); ++cit) {
     // If the item at hand is neither the first nor the last one ...
     if (cit != items.cbegin() && cit != items.cend()) {
       // ... check if the previous item is either of another type or if both
       // items are of type "Node" ...
-      if (((*(*(cit - 1))).IsSameType(*(*cit).get()) == false) ||
+      if (((*(cit - 1))->IsSameType(**cit) == false) ||
           (((*(cit - 1))->GetType() == Type::NODE) &&
            ((*cit)->GetType() == Type::NODE))) {
         // ... and insert a newline if so
-        resultStr.append("\n");
+        argOutputSink.Append('\n');
       }
       // If the item at hand is at the very first one ...
     } else if (cit == items.cbegin()) {
       // ... and of type "Node", ...
       if ((*cit)->GetType() == Type::NODE) {
         // ... then insert a newline
-        resultStr.append("\n");
+        argOutputSink.Append('\n');
       }
     }
-    resultStr.append((*cit)->GetStringRep() + "\n");
+    (*cit)->Serialize(argOutputSink);
+    argOutputSink.Append('\n');
   }
-  resultStr.append(GetPrependedTabs() + "};");
-  return resultStr;
+  argOutputSink.AppendTabs(level);
+  argOutputSink.Append("};");
 }
 
-bool Node::IsNodeEndLine(const std::string &argLine) {
-  return argLine.find("};") != std::string::npos;
+bool Node::IsNodeEndLine(const std::string_view argLine) {
+  return argLine.find("};") != std::string_view::npos;
 }
 
-bool Node::IsNodeStartLine(const std::string &argLine) {
-  return argLine.find('{') != std::string::npos;
+bool Node::IsNodeStartLine(const std::string_view argLine) {
+  return argLine.find('{') != std::string_view::npos;
 }
 
 void Node::Merge(const Item *argOtherItem, const bool argAddFromOther,
@@ -173,41 +397,94 @@ void Node::Merge(const Item *argOtherItem, const bool argAddFromOther,
 
   Item::Merge(argOtherItem, argAddFromOther, argPurgeItemsNotInOther);
 
-  // Merge items existing in this item with their counterparts of the other item
-  for (auto cit = items.cbegin(); cit != items.cend();) {
-    const auto counterpart = std::find_if(
-        std::begin(otherNode->items), std::end(otherNode->items),
-        [&cit](const SharedPtrItem &argOtherSharedPtrItem) {
-          return (*cit)->GetName() == argOtherSharedPtrItem->GetName();
-        });
-    if (counterpart != std::end(otherNode->items)) {
-      (*cit)->Merge(counterpart->get(), argAddFromOther,
-                    argPurgeItemsNotInOther);
+  // Merge items existing in this item with their counterparts of the other
+  // item, which are matched by name, unit address and kind, so that a node and
+  // a property of the same name never take each other's place. Equal items are
+  // left alone, which leaves whole subtrees untouched.
+  // Subtrees with duplicate names are merged anyways, as only the first of the
+  // other node's items of a name is merged into all of them. Shared items are
+  // copied before modifying them.
+  const auto itemQty = items.size();
+  for (auto it = items.begin(); it != items.end();) {
+    const auto isProperty = (*it)->GetType() == Type::PROPERTY;
+    const auto counterpart = otherNode->FindItem(
+        (*it)->GetNameId(), (*it)->GetUnitAddressId(), isProperty);
+    if (counterpart != nullptr) {
+      // Properties whose values changed their kind are replaced as a whole
+      if ((isProperty == true) && (typeid(**it) != typeid(*counterpart))) {
+        *it = ShareItem(counterpart);
+      } else if (((*it)->Compare(counterpart) == false) ||
+                 (((*it)->GetType() == Type::NODE) &&
+                  static_cast<const Node *>(*it)->hasDuplicateNames)) {
+        if ((*it)->IsShared()) {
+          *it = UnshareItem(*it);
+        }
+        (*it)->Merge(counterpart, argAddFromOther, argPurgeItemsNotInOther);
+      }
     } else {
       if (argPurgeItemsNotInOther == true) {
-        cit = items.erase(cit);
+        it = items.erase(it);
         continue;
       }
     }
-    ++cit;
+    ++it;
+  }
+  if (items.size() != itemQty) {
+    BuildChildIndex();
   }
 
   if (argAddFromOther == true) {
-    for (const auto &sharedPtrItem : otherNode->items) {
-      const auto counterpart = std::find_if(
-          std::begin(items), std::end(items),
-          [&sharedPtrItem](const SharedPtrItem &argSharedPtrItem) {
-            return sharedPtrItem->GetName() == argSharedPtrItem->GetName();
-          });
-      if (counterpart == std::end(items)) {
-        items.emplace_back(CopySharedPtrItem(sharedPtrItem));
+    const auto mergedItemQty = items.size();
+    for (const auto otherItem : otherNode->items) {
+      // Of multiple items with the same name only the first one is added, like
+      // the others would find it as counterpart
+      const auto nameId = otherItem->GetNameId();
+      const auto unitAddressId = otherItem->GetUnitAddressId();
+      const auto isProperty = otherItem->GetType() == Type::PROPERTY;
+      if ((FindItem(nameId, unitAddressId, isProperty) == nullptr) &&
+          (otherNode->FindItem(nameId, unitAddressId, isProperty) ==
+           otherItem)) {
+        items.emplace_back(ShareItem(otherItem));
       }
     }
+    if (items.size() != mergedItemQty) {
+      BuildChildIndex();
+    }
+  }
+  UpdateHash();
+}
+
+Item *Node::ShareItem(const Item *const argItem) const {
+  if (argItem->GetLevel() != level + 1) {
+    return CloneItem(argItem, this);
+  }
+
+  // Shared items are never modified by any tree, but copied first
+  argItem->shared = true;
+  return const_cast<Item *>(argItem);
+}
+
+Item *Node::UnshareItem(const Item *const argItem) const {
+  if (argItem->GetType() == Type::PROPERTY) {
+    return CloneItem(argItem, this);
+  }
+
+  // Copying the node and sharing its items suffices, as its items are copied
+  // in turn once they get modified
+  return arena.Create<Node>(*static_cast<const Node *>(argItem), this,
+                            ShareItems{});
+}
+
+NamePool::NameId Node::InternLabel(const std::string_view argLabel) {
+  if (argLabel.empty()) {
+    return NamePool::EMPTY_NAME_ID;
   }
+  Label::VerifyLabel(argLabel);
+  return NamePool::GetInstance().Intern(argLabel);
 }
 
-const std::string &Node::VerifyNodeName(bool argIsRootNode,
-                                        const std::string &argNodeName) {
+std::string_view Node::VerifyNodeName(bool argIsRootNode,
+                                      const std::string_view argNodeName) {
   // The root node's name must always be '/'
   if (argIsRootNode == true) {
     if (argNodeName == "/") {
@@ -247,8 +524,7 @@ const std::string &Node::VerifyNodeName(bool argIsRootNode,
   }
 
   // Node name shall consist only of a certain set of characters
-  if (argNodeName.find_first_not_of(VALID_NODE_NAME_CHARS) !=
-      std::string::npos) {
+  if (ConsistsOfCharClass(argNodeName, CharClass::NODE_NAME) == false) {
     throw InvalidNodeNameException{};
   }
 
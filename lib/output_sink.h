@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef OUTPUT_SINK_H
+#define OUTPUT_SINK_H
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// Collects output in a buffer which is written to a stream in large blocks
+// once it is full and on destruction. Formatting code may append to the buffer
+// directly, as long as one of the Append methods follows to write it out.
+class OutputSink {
+public:
+  static constexpr std::size_t BUFFER_SIZE = 1 << 16;
+
+  explicit OutputSink(std::ostream &argOutputStream);
+  OutputSink(const OutputSink &argOutputSink) = delete;
+  ~OutputSink();
+
+  OutputSink &operator=(const OutputSink &argOutputSink) = delete;
+
+  void Append(char argChar) {
+    buffer.push_back(argChar);
+    WriteIfFull();
+  }
+  void Append(std::string_view argString) {
+    buffer.append(argString);
+    WriteIfFull();
+  }
+  void AppendTabs(std::size_t argQty) {
+    buffer.append(argQty, '\t');
+    WriteIfFull();
+  }
+  std::string &GetBuffer() noexcept { return buffer; }
+  void Write();
+
+private:
+  void WriteIfFull() {
+    if (buffer.size() >= BUFFER_SIZE) {
+      Write();
+    }
+  }
+
+  std::ostream &outputStream;
+  std::string buffer;
+};
+
+#endif // OUTPUT_SINK_H
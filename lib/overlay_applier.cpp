@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "overlay_applier.h"
+#include "property.h"
+#include "root_node.h"
+
+#include <iostream>
+
+OverlayApplier::OverlayApplier(RootNode &argBaseRootNode,
+                               std::ostream &argErrorStream)
+    : baseRootNode{argBaseRootNode}, errorStream{argErrorStream} {
+  NodePath path;
+  IndexLabels(baseRootNode, path);
+}
+
+bool OverlayApplier::Apply(const RootNode &argOverlayRootNode) {
+  static const auto overlayNameId =
+      NamePool::GetInstance().Intern("__overlay__");
+
+  // Items of the overlay may be shared by the base tree from now on
+  baseRootNode.AdoptArenasOf(argOverlayRootNode);
+  baseRootNode.InvalidatePathIndex();
+
+  for (const auto fragmentItem : argOverlayRootNode.GetItems()) {
+    if (fragmentItem->GetType() != Item::Type::NODE) {
+      continue;
+    }
+    const auto &fragmentNode = *static_cast<const Node *>(fragmentItem);
+    const auto overlayItem =
+        fragmentNode.FindItem(overlayNameId, NamePool::EMPTY_NAME_ID);
+    if ((overlayItem == nullptr) ||
+        (overlayItem->GetType() != Item::Type::NODE)) {
+      continue;
+    }
+
+    NodePath targetPath;
+    if (ResolveTarget(fragmentNode, targetPath) == false) {
+      errorStream << "Failed to resolve target of overlay fragment: "
+                  << fragmentNode.GetDevicePath() << "\n";
+      return false;
+    }
+
+    // Walk down to the target node, copying shared nodes on the way as all of
+    // them are going to be modified
+    std::vector<Node *> ancestorNodes;
+    Node *targetNode = &baseRootNode;
+    for (const auto &element : targetPath) {
+      const auto childItem = targetNode->FindItemSlot(
+          element.nameId, element.unitAddressId, false);
+      if (childItem == nullptr) {
+        errorStream << "Failed to find target node of overlay fragment: "
+                    << fragmentNode.GetDevicePath() << "\n";
+        return false;
+      }
+      if ((*childItem)->IsShared()) {
+        *childItem = targetNode->UnshareItem(*childItem);
+      }
+      ancestorNodes.emplace_back(targetNode);
+      targetNode = static_cast<Node *>(*childItem);
+    }
+
+    const auto &overlayNode = *static_cast<const Node *>(overlayItem);
+    MergeOverlayNode(*targetNode, overlayNode);
+    for (auto it = ancestorNodes.rbegin(); it != ancestorNodes.rend(); ++it) {
+      (*it)->UpdateHash();
+    }
+
+    // Labels defined by the overlay can be referenced by later overlays
+    IndexLabels(overlayNode, targetPath);
+  }
+
+  return true;
+}
+
+void OverlayApplier::IndexLabels(const Node &argNode, NodePath &argPath) {
+  for (const auto item : argNode.GetItems()) {
+    if (item->GetType() != Item::Type::NODE) {
+      continue;
+    }
+    const auto &childNode = *static_cast<const Node *>(item);
+    argPath.push_back({childNode.GetNameId(), childNode.GetUnitAddressId()});
+    if (childNode.GetLabelId() != NamePool::EMPTY_NAME_ID) {
+      // Like on compiling, the first definition of a label is used
+      labelPaths.emplace(childNode.GetLabel(), argPath);
+    }
+    IndexLabels(childNode, argPath);
+    argPath.pop_back();
+  }
+}
+
+void OverlayApplier::MergeOverlayNode(Node &argNode,
+                                      const Node &argOverlayNode) {
+  const auto itemQty = argNode.items.size();
+  for (const auto overlayItem : argOverlayNode.items) {
+    // Nodes and properties may have the same name, but only items of the same
+    // kind are merged
+    const auto isProperty = overlayItem->GetType() == Item::Type::PROPERTY;
+    const auto counterpart = argNode.FindItemSlot(
+        overlayItem->GetNameId(), overlayItem->GetUnitAddressId(), isProperty);
+
+    if (counterpart == nullptr) {
+      argNode.items.emplace_back(argNode.ShareItem(overlayItem));
+    } else if ((*counterpart)->Compare(overlayItem) == true) {
+      continue;
+    } else if (isProperty) {
+      *counterpart = argNode.ShareItem(overlayItem);
+    } else {
+      if ((*counterpart)->IsShared()) {
+        *counterpart = argNode.UnshareItem(*counterpart);
+      }
+      MergeOverlayNode(*static_cast<Node *>(*counterpart),
+                       *static_cast<const Node *>(overlayItem));
+    }
+  }
+  if (argNode.items.size() != itemQty) {
+    argNode.BuildChildIndex();
+  }
+  argNode.UpdateHash();
+}
+
+bool OverlayApplier::ResolveTarget(const Node &argFragmentNode,
+                                   NodePath &argPath) const {
+  auto &namePool = NamePool::GetInstance();
+  static const auto targetNameId = namePool.Intern("target");
+  static const auto targetPathNameId = namePool.Intern("target-path");
+
+  // A label reference is resolved through the label index
+  const auto target = dynamic_cast<const PropertyValuePHandle *>(
+      argFragmentNode.FindItem(targetNameId, NamePool::EMPTY_NAME_ID));
+  if (target != nullptr) {
+    if (target->GetReferences().empty()) {
+      return false;
+    }
+    const auto labelPath =
+        labelPaths.find(target->GetReferences().front().label);
+    if (labelPath == labelPaths.end()) {
+      return false;
+    }
+    argPath = labelPath->second;
+    return true;
+  }
+
+  const auto targetPath = dynamic_cast<const PropertyValueStringList *>(
+      argFragmentNode.FindItem(targetPathNameId, NamePool::EMPTY_NAME_ID));
+  if (targetPath == nullptr) {
+    return false;
+  }
+  const auto strings = targetPath->GetStrings();
+  if (strings.size() != 1) {
+    return false;
+  }
+  auto path = strings.front();
+  if ((path.empty() == true) || (path.front() != '/')) {
+    return false;
+  }
+  argPath.clear();
+  while (path.empty() == false) {
+    const auto slashPos = path.find('/');
+    const auto nodeName = path.substr(0, slashPos);
+    path = (slashPos == std::string_view::npos) ? std::string_view{}
+                                                : path.substr(slashPos + 1);
+    if (nodeName.empty()) {
+      continue;
+    }
+    const auto atPos = nodeName.find('@');
+    argPath.push_back(
+        {namePool.Intern(nodeName.substr(0, atPos)),
+         (atPos == std::string_view::npos)
+             ? NamePool::EMPTY_NAME_ID
+             : namePool.Intern(nodeName.substr(atPos + 1))});
+  }
+  return true;
+}
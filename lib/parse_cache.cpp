@@ -0,0 +1,502 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "parse_cache.h"
+#include "arena.h"
+#include "fdt.h"
+#include "hash.h"
+#include "mapped_file.h"
+#include "property.h"
+#include "root_node.h"
+#include "value_codec.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+// Entries start with a header of magic number, format version and the key of
+// the source they have been parsed from. It is followed by a table of all
+// distinct names, which are interned only once on loading, and the records of
+// all items in depth-first order referring to the names by their position. Like
+// in device tree blobs all numbers are stored as big endian 32 bit words and
+// strings are padded to whole words.
+constexpr uint32_t CACHE_MAGIC = 0x44545043; // "DTPC"
+// Must be increased whenever the format, the parsing results or the hashes of
+// items change
+constexpr uint32_t CACHE_VERSION = 5;
+
+enum class RecordTag : uint32_t {
+  NODE = 1,
+  PROPERTY_EMPTY,
+  PROPERTY_PHANDLE,
+  PROPERTY_STRING,
+  PROPERTY_STRING_LIST,
+  PROPERTY_U32,
+  PROPERTY_U64,
+};
+
+// Smallest possible record, which is an empty property
+constexpr std::size_t MINIMUM_RECORD_SIZE = 2 * sizeof(uint32_t);
+
+class InvalidCacheEntryException : public std::exception {
+  const char *what() const noexcept override;
+};
+
+const char *InvalidCacheEntryException::what() const noexcept {
+  return "Encountered invalid structure on parse cache entry loading";
+}
+
+// Bounds-checked sequential reading of the words and strings of an entry
+class EntryReader {
+public:
+  EntryReader(const std::string_view argEntry) : entry{argEntry} {}
+
+  std::size_t GetRemainingSize() const noexcept {
+    return entry.size() - offset;
+  }
+  // Read a reference into the name table
+  NamePool::NameId ReadNameId() {
+    const auto nameIdx = ReadU32();
+    if (nameIdx >= nameIds.size()) {
+      throw InvalidCacheEntryException{};
+    }
+    return nameIds[nameIdx];
+  }
+  void ReadNameTable() {
+    const auto nameQty = ReadU32();
+    if (nameQty > GetRemainingSize() / sizeof(uint32_t)) {
+      throw InvalidCacheEntryException{};
+    }
+    nameIds.reserve(nameQty);
+    for (uint32_t i = 0; i < nameQty; ++i) {
+      nameIds.emplace_back(NamePool::GetInstance().Intern(ReadString()));
+    }
+  }
+  std::string_view ReadString() {
+    const auto size = ReadU32();
+    if (size > GetRemainingSize()) {
+      throw InvalidCacheEntryException{};
+    }
+    const auto string = entry.substr(offset, size);
+    offset = std::min(AlignToWord(offset + size), entry.size());
+    return string;
+  }
+  uint32_t ReadU32() {
+    if (GetRemainingSize() < sizeof(uint32_t)) {
+      throw InvalidCacheEntryException{};
+    }
+    const auto word = ReadBigEndianU32(entry.data() + offset);
+    offset += sizeof(uint32_t);
+    return word;
+  }
+  uint64_t ReadU64() {
+    const uint64_t upperWord = ReadU32();
+    return (upperWord << 32) | ReadU32();
+  }
+
+private:
+  static constexpr std::size_t AlignToWord(const std::size_t argOffset) {
+    return (argOffset + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1);
+  }
+
+  const std::string_view entry;
+  std::size_t offset = 0;
+  std::vector<NamePool::NameId> nameIds;
+};
+
+// Serialization of the records of an entry, collecting the names on the way
+class EntryWriter {
+public:
+  void AppendCells(const std::pmr::vector<uint32_t> &argCells) {
+    AppendU32(static_cast<uint32_t>(argCells.size() * sizeof(uint32_t)));
+    for (const auto cell : argCells) {
+      AppendU32(cell);
+    }
+  }
+  void AppendCells(const std::pmr::vector<uint64_t> &argCells) {
+    AppendU32(static_cast<uint32_t>(argCells.size() * sizeof(uint64_t)));
+    for (const auto cell : argCells) {
+      AppendU64(cell);
+    }
+  }
+  // Store a single notation if all cells share it
+  void AppendCellNotations(const CellNotations &argCellNotations,
+                           const std::size_t argCellQty) {
+    std::string notations(1, static_cast<char>(argCellNotations.Get(0)));
+    if (argCellNotations.IsUniform() == false) {
+      notations.resize(argCellQty);
+      for (std::size_t i = 1; i < argCellQty; ++i) {
+        notations[i] = static_cast<char>(argCellNotations.Get(i));
+      }
+    }
+    AppendString(notations);
+  }
+  void AppendNameId(const NamePool::NameId argNameId) {
+    const auto insertResult = nameIdxs.emplace(
+        argNameId, static_cast<uint32_t>(nameIdxs.size()));
+    AppendU32(insertResult.first->second);
+  }
+  void AppendString(const std::string_view argString) {
+    AppendString(records, argString);
+  }
+  void AppendU32(const uint32_t argValue) {
+    AppendBigEndianU32(records, argValue);
+  }
+  void AppendU64(const uint64_t argValue) {
+    AppendU32(static_cast<uint32_t>(argValue >> 32));
+    AppendU32(static_cast<uint32_t>(argValue));
+  }
+  // Return the complete entry with the given header prepended
+  std::string GetEntry(const std::string &argHeader) const {
+    std::vector<NamePool::NameId> nameIds(nameIdxs.size());
+    for (const auto &nameIdx : nameIdxs) {
+      nameIds[nameIdx.second] = nameIdx.first;
+    }
+
+    std::string entry{argHeader};
+    AppendBigEndianU32(entry, static_cast<uint32_t>(nameIds.size()));
+    for (const auto nameId : nameIds) {
+      AppendString(entry, NamePool::GetInstance().GetName(nameId));
+    }
+    entry.append(records);
+    return entry;
+  }
+
+private:
+  static void AppendString(std::string &argOutput,
+                           const std::string_view argString) {
+    AppendBigEndianU32(argOutput, static_cast<uint32_t>(argString.size()));
+    argOutput.append(argString);
+    argOutput.resize(AlignToFdtToken(static_cast<uint32_t>(argOutput.size())),
+                     '\0');
+  }
+
+  std::string records;
+  std::unordered_map<NamePool::NameId, uint32_t> nameIdxs;
+};
+
+static void SerializeProperty(const Property &argProperty,
+                              EntryWriter &argEntryWriter) {
+  const auto appendHeader = [&](const RecordTag argTag) {
+    argEntryWriter.AppendU32(static_cast<uint32_t>(argTag));
+    argEntryWriter.AppendNameId(argProperty.GetNameId());
+  };
+
+  switch (argProperty.GetValueType()) {
+  case Property::ValueType::EMPTY:
+    appendHeader(RecordTag::PROPERTY_EMPTY);
+    return;
+  case Property::ValueType::PHANDLE: {
+    const auto &property =
+        static_cast<const PropertyValuePHandle &>(argProperty);
+    appendHeader(RecordTag::PROPERTY_PHANDLE);
+    argEntryWriter.AppendCells(property.GetCells());
+    argEntryWriter.AppendCellNotations(property.GetCellNotations(),
+                                       property.GetCells().size());
+    argEntryWriter.AppendU32(
+        static_cast<uint32_t>(property.GetReferences().size()));
+    for (const auto &reference : property.GetReferences()) {
+      argEntryWriter.AppendU32(reference.cellIndex);
+      argEntryWriter.AppendString(reference.label);
+    }
+    return;
+  }
+  case Property::ValueType::STRING:
+    appendHeader(RecordTag::PROPERTY_STRING);
+    argEntryWriter.AppendString(
+        static_cast<const PropertyValueString &>(argProperty).GetValue());
+    return;
+  case Property::ValueType::STRING_LIST:
+    appendHeader(RecordTag::PROPERTY_STRING_LIST);
+    argEntryWriter.AppendString(argProperty.GetEncodedValue());
+    return;
+  case Property::ValueType::U32: {
+    const auto &property = static_cast<const PropertyValueU32 &>(argProperty);
+    appendHeader(RecordTag::PROPERTY_U32);
+    argEntryWriter.AppendCells(property.GetCells());
+    argEntryWriter.AppendCellNotations(property.GetCellNotations(),
+                                       property.GetCells().size());
+    return;
+  }
+  case Property::ValueType::U64: {
+    const auto &property = static_cast<const PropertyValueU64 &>(argProperty);
+    appendHeader(RecordTag::PROPERTY_U64);
+    argEntryWriter.AppendCells(property.GetCells());
+    argEntryWriter.AppendCellNotations(property.GetCellNotations(),
+                                       property.GetCells().size());
+    return;
+  }
+  }
+}
+
+ParseCache::ParseCache(const std::string &argDirectoryPath)
+    : directoryPath{argDirectoryPath} {}
+
+ParseCache::~ParseCache() {}
+
+ParseCache::Key ParseCache::GetKey(const std::string_view argSource) noexcept {
+  // Hash whole words at once, which keeps hashing large sources cheap compared
+  // to parsing them
+  auto hash = FNV_OFFSET_BASIS;
+  std::string_view::size_type i = 0;
+  for (; i + sizeof(uint64_t) <= argSource.size(); i += sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, argSource.data() + i, sizeof(word));
+    hash = HashNumber(hash, word);
+  }
+  hash = HashBytes(hash, argSource.data() + i, argSource.size() - i);
+
+  return {hash, argSource.size()};
+}
+
+std::unique_ptr<RootNode>
+ParseCache::Load(const Key &argKey, std::ostream &argErrorStream) const {
+  // Entries are only ever replaced as a whole, so the mapping stays consistent
+  // even if the entry is written anew concurrently
+  const MappedFile mappedFile{GetEntryPath(argKey)};
+  if (mappedFile.IsMapped() == false) {
+    return nullptr;
+  }
+
+  try {
+    EntryReader entryReader{mappedFile.GetView()};
+    if ((entryReader.ReadU32() != CACHE_MAGIC) ||
+        (entryReader.ReadU32() != CACHE_VERSION) ||
+        (entryReader.ReadU64() != argKey.sourceHash) ||
+        (entryReader.ReadU64() != argKey.sourceSize)) {
+      return nullptr;
+    }
+    entryReader.ReadNameTable();
+
+    if (static_cast<RecordTag>(entryReader.ReadU32()) != RecordTag::NODE) {
+      throw InvalidCacheEntryException{};
+    }
+    std::unique_ptr<RootNode> rootNode{
+        new RootNode{std::make_shared<Arena>()}};
+    if ((entryReader.ReadNameId() != rootNode->GetNameId()) ||
+        (entryReader.ReadNameId() != rootNode->GetUnitAddressId())) {
+      throw InvalidCacheEntryException{};
+    }
+    DeserializeNodeContents(entryReader, *rootNode);
+    if (entryReader.GetRemainingSize() != 0) {
+      throw InvalidCacheEntryException{};
+    }
+
+    return rootNode;
+  } catch (const std::exception &argException) {
+    // Broken entries are treated like missing ones and get replaced
+    argErrorStream << "Ignoring parse cache entry " << GetEntryPath(argKey)
+                   << ": " << argException.what() << "\n";
+    return nullptr;
+  }
+}
+
+bool ParseCache::Store(const Key &argKey, const RootNode &argRootNode,
+                       std::ostream &argErrorStream) const {
+  EntryWriter entryWriter;
+  SerializeNode(argRootNode, entryWriter);
+  std::string header;
+  AppendBigEndianU32(header, CACHE_MAGIC);
+  AppendBigEndianU32(header, CACHE_VERSION);
+  AppendBigEndianU32(header, static_cast<uint32_t>(argKey.sourceHash >> 32));
+  AppendBigEndianU32(header, static_cast<uint32_t>(argKey.sourceHash));
+  AppendBigEndianU32(header, static_cast<uint32_t>(argKey.sourceSize >> 32));
+  AppendBigEndianU32(header, static_cast<uint32_t>(argKey.sourceSize));
+  const auto entry = entryWriter.GetEntry(header);
+
+  std::error_code errorCode;
+  std::filesystem::create_directories(directoryPath, errorCode);
+  if (errorCode) {
+    argErrorStream << "Failed to create parse cache directory: "
+                   << directoryPath << "\n";
+    return false;
+  }
+
+  // Write the entry to a file unique to this process and call first and move
+  // it into place afterwards, which replaces any existing entry atomically
+  static std::atomic<uint_fast32_t> temporaryFileQty{0};
+  const auto entryPath = GetEntryPath(argKey);
+  const auto temporaryPath = entryPath + "." + std::to_string(getpid()) + "." +
+                             std::to_string(temporaryFileQty++) + ".tmp";
+  std::ofstream outputFile{temporaryPath,
+                           std::ios_base::binary | std::ios_base::trunc};
+  if (outputFile.fail()) {
+    argErrorStream << "Failed to open parse cache file: " << temporaryPath
+                   << "\n";
+    return false;
+  }
+  outputFile.write(entry.data(), static_cast<std::streamsize>(entry.size()));
+  outputFile.close();
+  if (outputFile.fail()) {
+    argErrorStream << "Failed to write parse cache file: " << temporaryPath
+                   << "\n";
+    std::filesystem::remove(temporaryPath, errorCode);
+    return false;
+  }
+
+  std::filesystem::rename(temporaryPath, entryPath, errorCode);
+  if (errorCode) {
+    argErrorStream << "Failed to rename parse cache file: " << temporaryPath
+                   << "\n";
+    std::filesystem::remove(temporaryPath, errorCode);
+    return false;
+  }
+
+  return true;
+}
+
+// Read the cell notations following the cells of the given size, which are
+// either one for all cells or one per cell
+static std::string_view ReadCellNotations(EntryReader &argEntryReader,
+                                          const std::string_view argCells,
+                                          const std::size_t argCellSize) {
+  const auto cellNotations = argEntryReader.ReadString();
+  if ((argCells.size() % argCellSize != 0) ||
+      ((cellNotations.size() != 1) &&
+       (cellNotations.size() != argCells.size() / argCellSize))) {
+    throw InvalidCacheEntryException{};
+  }
+  return cellNotations;
+}
+
+void ParseCache::DeserializeNodeContents(EntryReader &argEntryReader,
+                                         Node &argNode) {
+  argNode.labelId = argEntryReader.ReadNameId();
+  // The hash is taken over instead of computing it from all items again
+  argNode.hash = argEntryReader.ReadU64();
+  argNode.subtreeSize = argEntryReader.ReadU32();
+  argNode.hasDuplicateNames = argEntryReader.ReadU32() != 0;
+  const auto itemQty = argEntryReader.ReadU32();
+  if (itemQty > argEntryReader.GetRemainingSize() / MINIMUM_RECORD_SIZE) {
+    throw InvalidCacheEntryException{};
+  }
+
+  auto &arena = argNode.GetArena();
+  argNode.items.reserve(itemQty);
+  for (uint32_t i = 0; i < itemQty; ++i) {
+    const auto tag = static_cast<RecordTag>(argEntryReader.ReadU32());
+    const auto nameId = argEntryReader.ReadNameId();
+    switch (tag) {
+    case RecordTag::NODE: {
+      const auto childNode = arena.Create<Node>(
+          nameId, argEntryReader.ReadNameId(), &argNode, arena);
+      DeserializeNodeContents(argEntryReader, *childNode);
+      argNode.items.emplace_back(childNode);
+      break;
+    }
+    case RecordTag::PROPERTY_EMPTY:
+      argNode.items.emplace_back(
+          arena.Create<PropertyEmpty>(nameId, &argNode));
+      break;
+    case RecordTag::PROPERTY_PHANDLE: {
+      const auto cells = argEntryReader.ReadString();
+      const auto cellNotations =
+          ReadCellNotations(argEntryReader, cells, sizeof(uint32_t));
+      const auto referenceQty = argEntryReader.ReadU32();
+      if ((cells.size() % sizeof(uint32_t) != 0) ||
+          (referenceQty > cells.size() / sizeof(uint32_t))) {
+        throw InvalidCacheEntryException{};
+      }
+      std::vector<CellReference> references(referenceQty);
+      for (auto &reference : references) {
+        reference.cellIndex = argEntryReader.ReadU32();
+        reference.label = argEntryReader.ReadString();
+        if (reference.cellIndex >= cells.size() / sizeof(uint32_t)) {
+          throw InvalidCacheEntryException{};
+        }
+      }
+      argNode.items.emplace_back(arena.Create<PropertyValuePHandle>(
+          nameId, &argNode, cells, references, cellNotations));
+      break;
+    }
+    case RecordTag::PROPERTY_STRING:
+      argNode.items.emplace_back(arena.Create<PropertyValueString>(
+          nameId, &argNode, argEntryReader.ReadString()));
+      break;
+    case RecordTag::PROPERTY_STRING_LIST:
+      argNode.items.emplace_back(arena.Create<PropertyValueStringList>(
+          nameId, &argNode, argEntryReader.ReadString()));
+      break;
+    case RecordTag::PROPERTY_U32: {
+      const auto cells = argEntryReader.ReadString();
+      const auto cellNotations =
+          ReadCellNotations(argEntryReader, cells, sizeof(uint32_t));
+      argNode.items.emplace_back(arena.Create<PropertyValueU32>(
+          nameId, &argNode, cells, cellNotations));
+      break;
+    }
+    case RecordTag::PROPERTY_U64: {
+      const auto cells = argEntryReader.ReadString();
+      const auto cellNotations =
+          ReadCellNotations(argEntryReader, cells, sizeof(uint64_t));
+      argNode.items.emplace_back(arena.Create<PropertyValueU64>(
+          nameId, &argNode, cells, cellNotations));
+      break;
+    }
+    default:
+      throw InvalidCacheEntryException{};
+    }
+  }
+
+  argNode.BuildChildIndex();
+}
+
+std::string ParseCache::GetEntryPath(const Key &argKey) const {
+  // The format version is part of the name, so that differing versions of this
+  // tool sharing a cache do not keep replacing each other's entries
+  std::ostringstream entryPath;
+  entryPath << directoryPath << "/" << std::hex << std::setfill('0')
+            << std::setw(16) << argKey.sourceHash << "-" << argKey.sourceSize
+            << "-v" << std::dec << CACHE_VERSION << ".dtpc";
+  return entryPath.str();
+}
+
+void ParseCache::SerializeNode(const Node &argNode,
+                               EntryWriter &argEntryWriter) {
+  argEntryWriter.AppendU32(static_cast<uint32_t>(RecordTag::NODE));
+  argEntryWriter.AppendNameId(argNode.GetNameId());
+  argEntryWriter.AppendNameId(argNode.GetUnitAddressId());
+  argEntryWriter.AppendNameId(argNode.GetLabelId());
+  argEntryWriter.AppendU64(argNode.GetHash());
+  argEntryWriter.AppendU32(argNode.GetSubtreeSize());
+  argEntryWriter.AppendU32(argNode.hasDuplicateNames ? 1 : 0);
+  argEntryWriter.AppendU32(static_cast<uint32_t>(argNode.items.size()));
+
+  for (const auto &item : argNode.items) {
+    if (item->GetType() == Item::Type::PROPERTY) {
+      SerializeProperty(*static_cast<const Property *>(item), argEntryWriter);
+    } else {
+      SerializeNode(*static_cast<const Node *>(item), argEntryWriter);
+    }
+  }
+}
@@ -0,0 +1,331 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "patch.h"
+#include "diff_engine.h"
+#include "line_reader.h"
+#include "mapped_file.h"
+#include "property.h"
+#include "root_node.h"
+#include "string_utils.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+constexpr std::string_view PATCH_VERSION_LINE = "/dtpatch-v1/;";
+constexpr std::string_view PATCH_HASHES_TAG = "/hashes/ ";
+
+class InvalidPatchLineException : public std::exception {
+  const char *what() const noexcept override;
+};
+
+const char *InvalidPatchLineException::what() const noexcept {
+  return "Encountered invalid line on patch applying";
+}
+
+// Return an item's device tree source representation without the indentation
+// of its first line
+static std::string GetItemLine(const Item &argItem) {
+  const auto stringRep = argItem.GetStringRep();
+  return std::string{RemoveLeadingWhitespace(stringRep)};
+}
+
+static uint64_t ParseHash(const std::string_view argHash) {
+  uint64_t hash = 0;
+  const auto hashEnd = argHash.data() + argHash.size();
+  const auto result = std::from_chars(argHash.data(), hashEnd, hash, 16);
+  if ((result.ec != std::errc{}) || (result.ptr != hashEnd)) {
+    throw InvalidPatchLineException{};
+  }
+  return hash;
+}
+
+PatchWriter::PatchWriter(const std::string &argFilePath,
+                         std::ostream &argErrorStream)
+    : patchFilePath{argFilePath}, errorStream{argErrorStream} {}
+
+bool PatchWriter::WriteFile(const RootNode &argRootNode1,
+                            const RootNode &argRootNode2,
+                            const std::vector<Difference> &argDifferences) {
+  std::ostringstream patch;
+  patch << PATCH_VERSION_LINE << "\n"
+        << PATCH_HASHES_TAG << std::hex << std::setfill('0') << std::setw(16)
+        << argRootNode1.GetHash() << " " << std::setw(16)
+        << argRootNode2.GetHash() << ";\n";
+
+  for (const auto &difference : argDifferences) {
+    const auto item = difference.item1 ? difference.item1 : difference.item2;
+    // The paths of nodes are their own ones, while the operations refer to
+    // the node holding the item
+    std::string_view path{difference.path};
+    if (item->GetType() != Item::Type::PROPERTY) {
+      path = path.substr(0, std::max<std::string_view::size_type>(
+                                path.rfind('/'), 1));
+    }
+
+    switch (difference.type) {
+    case Difference::Type::ADDED:
+      patch << "+ " << path << "\t" << GetItemLine(*item) << "\n";
+      break;
+    case Difference::Type::CHANGED:
+      patch << "= " << path << "\t" << GetItemLine(*difference.item2)
+            << "\n";
+      break;
+    case Difference::Type::REMOVED:
+      patch << "- " << path << "\t" << item->GetName();
+      if (item->GetType() == Item::Type::PROPERTY) {
+        patch << ";\n";
+      } else {
+        patch << " {};\n";
+      }
+      break;
+    }
+  }
+
+  std::ofstream outputFile{patchFilePath, std::ios_base::trunc};
+  if (outputFile.fail()) {
+    errorStream << "Failed to open patch file: " << patchFilePath << "\n";
+    return false;
+  }
+  const auto patchStr = patch.str();
+  outputFile.write(patchStr.data(),
+                   static_cast<std::streamsize>(patchStr.size()));
+  outputFile.close();
+  if (outputFile.fail()) {
+    errorStream << "Failed to write patch file: " << patchFilePath << "\n";
+    return false;
+  }
+
+  return true;
+}
+
+PatchApplier::PatchApplier(const std::string &argFilePath,
+                           std::ostream &argErrorStream)
+    : patchFilePath{argFilePath}, errorStream{argErrorStream} {}
+
+bool PatchApplier::ApplyFile(RootNode &argRootNode) {
+  const MappedFile mappedFile{patchFilePath};
+  if (mappedFile.IsMapped() == false) {
+    errorStream << "Failed to map patch file: " << patchFilePath << "\n";
+    return false;
+  }
+
+  LineReader lineReader{mappedFile.GetView()};
+  std::string_view line;
+  if ((lineReader.GetLine(line) == false) || (line != PATCH_VERSION_LINE) ||
+      (lineReader.GetLine(line) == false) ||
+      (line.substr(0, PATCH_HASHES_TAG.size()) != PATCH_HASHES_TAG)) {
+    throw InvalidPatchLineException{};
+  }
+  const auto hashes =
+      RemoveTrailingSemicolon(line.substr(PATCH_HASHES_TAG.size()));
+  const auto spacePos = hashes.find(' ');
+  if (spacePos == std::string_view::npos) {
+    throw InvalidPatchLineException{};
+  }
+  const auto expectedHash = ParseHash(hashes.substr(0, spacePos));
+  const auto resultHash = ParseHash(hashes.substr(spacePos + 1));
+  if (argRootNode.GetHash() != expectedHash) {
+    errorStream << "Patch does not belong to the device tree: " << patchFilePath
+                << "\n";
+    return false;
+  }
+
+  argRootNode.InvalidatePathIndex();
+  // The modified nodes are brought into a consistent state again even if an
+  // operation failed
+  modifiedNodes.clear();
+  lastPath.clear();
+  lastNode = nullptr;
+  bool applied = false;
+  try {
+    applied = ApplyLines(lineReader, argRootNode);
+  } catch (...) {
+    UpdateModifiedNodes();
+    throw;
+  }
+  UpdateModifiedNodes();
+  if (applied == false) {
+    return false;
+  }
+
+  if (argRootNode.GetHash() != resultHash) {
+    errorStream << "Patching did not result in the expected device tree: "
+                << patchFilePath << "\n";
+    return false;
+  }
+  return true;
+}
+
+bool PatchApplier::ApplyLines(LineReader &argLineReader,
+                              RootNode &argRootNode) {
+  std::string_view line;
+  while (argLineReader.GetLine(line)) {
+    line = RemoveLeadingWhitespace(line);
+    if (line.empty()) {
+      continue;
+    }
+    if ((line.size() < 2) || (line[1] != ' ')) {
+      throw InvalidPatchLineException{};
+    }
+    const auto operation = line[0];
+    line = line.substr(2);
+    // Property lines are expected to be indented, so the tab is kept
+    const auto tabPos = line.find('\t');
+    if (tabPos == std::string_view::npos) {
+      throw InvalidPatchLineException{};
+    }
+    const auto path = line.substr(0, tabPos);
+    const auto itemLine = line.substr(tabPos);
+    const auto isProperty = Node::IsNodeStartLine(itemLine) == false;
+
+    const auto node = FindNode(path, argRootNode);
+    if (node == nullptr) {
+      errorStream << "Failed to find node of patch operation: " << path << "\n";
+      return false;
+    }
+
+    // Removed items are only cleared to keep the positions of the child index
+    // valid until the item lists are compacted
+    if (operation == '-') {
+      auto &namePool = NamePool::GetInstance();
+      Item **slot = nullptr;
+      if (isProperty) {
+        slot = node->FindItemSlot(
+            namePool.Intern(
+                RemoveTrailingSemicolon(RemoveLeadingWhitespace(itemLine))),
+            NamePool::EMPTY_NAME_ID, true);
+      } else {
+        const auto nodeName = ExtractNodeName(itemLine);
+        slot = node->FindItemSlot(namePool.Intern(nodeName.nodeName),
+                                  namePool.Intern(nodeName.unitAddress), false);
+        lastNode = nullptr;
+      }
+      if (slot == nullptr) {
+        errorStream << "Failed to find item to be removed by patch operation: "
+                    << path << itemLine << "\n";
+        return false;
+      }
+      *slot = nullptr;
+      modifiedNodes[node] = true;
+      continue;
+    }
+
+    if ((operation != '+') && (operation != '=')) {
+      throw InvalidPatchLineException{};
+    }
+    Item *item = nullptr;
+    if (isProperty) {
+      item = Property::Construct(itemLine, node);
+    } else {
+      item = node->GetArena().Create<Node>(itemLine, argLineReader, node,
+                                           node->GetArena());
+    }
+    if (operation == '+') {
+      node->items.emplace_back(item);
+      modifiedNodes[node] = true;
+      continue;
+    }
+    const auto slot = node->FindItemSlot(item->GetNameId(),
+                                         item->GetUnitAddressId(), isProperty);
+    if (slot == nullptr) {
+      errorStream << "Failed to find item to be replaced by patch operation: "
+                  << path << " " << item->GetName() << "\n";
+      return false;
+    }
+    *slot = item;
+    if (isProperty == false) {
+      lastNode = nullptr;
+    }
+  }
+
+  return true;
+}
+
+Node *PatchApplier::FindNode(const std::string_view argPath,
+                             RootNode &argRootNode) {
+  if ((lastNode != nullptr) && (argPath == lastPath)) {
+    return lastNode;
+  }
+  if (argPath.empty() || (argPath.front() != '/')) {
+    throw InvalidPatchLineException{};
+  }
+
+  auto &namePool = NamePool::GetInstance();
+  Node *node = &argRootNode;
+  modifiedNodes.emplace(node, false);
+  auto path = argPath.substr(1);
+  while (path.empty() == false) {
+    const auto slashPos = path.find('/');
+    const auto nodeName = path.substr(0, slashPos);
+    path = (slashPos == std::string_view::npos) ? std::string_view{}
+                                                : path.substr(slashPos + 1);
+    const auto atPos = nodeName.find('@');
+    const auto slot = node->FindItemSlot(
+        namePool.Intern(nodeName.substr(0, atPos)),
+        (atPos == std::string_view::npos)
+            ? NamePool::EMPTY_NAME_ID
+            : namePool.Intern(nodeName.substr(atPos + 1)),
+        false);
+    if (slot == nullptr) {
+      return nullptr;
+    }
+    // All nodes on the path are going to be modified
+    if ((*slot)->IsShared()) {
+      *slot = node->UnshareItem(*slot);
+    }
+    node = static_cast<Node *>(*slot);
+    modifiedNodes.emplace(node, false);
+  }
+
+  lastPath = argPath;
+  lastNode = node;
+  return node;
+}
+
+void PatchApplier::UpdateModifiedNodes() {
+  // Children have to be updated before their parents
+  std::vector<std::pair<Node *, bool>> nodes{std::begin(modifiedNodes),
+                                             std::end(modifiedNodes)};
+  std::sort(std::begin(nodes), std::end(nodes),
+            [](const std::pair<Node *, bool> &argNode1,
+               const std::pair<Node *, bool> &argNode2) {
+              return argNode1.first->GetLevel() > argNode2.first->GetLevel();
+            });
+  for (auto &node : nodes) {
+    if (node.second == true) {
+      auto &items = node.first->items;
+      items.erase(std::remove(std::begin(items), std::end(items), nullptr),
+                  std::end(items));
+      node.first->BuildChildIndex();
+    }
+    node.first->UpdateHash();
+  }
+  modifiedNodes.clear();
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "path_index.h"
+#include "root_node.h"
+
+#include <algorithm>
+
+// Return the size of a node's name including its unit address
+static std::string::size_type GetNameSize(const Node &argNode) {
+  const auto &unitAddress = argNode.GetUnitAddress();
+  return NamePool::GetInstance().GetName(argNode.GetNameId()).size() +
+         (unitAddress.empty() ? 0 : unitAddress.size() + 1);
+}
+
+PathIndex::PathIndex(const RootNode &argRootNode) {
+  // The buffer is sized up front, so that the paths never move
+  std::string::size_type nodeQty = 1;
+  std::string::size_type pathsSize = 1;
+  MeasureChildNodes(argRootNode, 0, nodeQty, pathsSize);
+  paths.reserve(pathsSize);
+  nodes.reserve(nodeQty);
+
+  paths.push_back('/');
+  nodes.emplace(paths, &argRootNode);
+  IndexChildNodes(argRootNode, {});
+}
+
+const Node *PathIndex::Find(const std::string_view argPath) const {
+  const auto node = nodes.find(argPath);
+  if (node == nodes.end()) {
+    return nullptr;
+  }
+  return node->second;
+}
+
+void PathIndex::IndexChildNodes(const Node &argNode,
+                                const std::string_view argPath) {
+  const auto &namePool = NamePool::GetInstance();
+  for (const auto item : argNode.GetItems()) {
+    if (item->GetType() != Item::Type::NODE) {
+      continue;
+    }
+    const auto &childNode = *static_cast<const Node *>(item);
+    // Of multiple nodes with the same name only the first one is found by
+    // walking the tree by name
+    if (argNode.hasDuplicateNames == true) {
+      const auto childKeys = argNode.FindChildKeys(
+          childNode.GetNameId(), childNode.GetUnitAddressId());
+      const auto firstNode = std::find_if(
+          childKeys.first, childKeys.second,
+          [&argNode](const Node::ChildKey &argKey) {
+            return argNode.items[argKey.position]->GetType() ==
+                   Item::Type::NODE;
+          });
+      if (argNode.items[firstNode->position] != &childNode) {
+        continue;
+      }
+    }
+
+    // The parent's path is part of the buffer already and copied from there
+    const auto pathStart = paths.size();
+    paths.append(argPath);
+    paths.push_back('/');
+    paths.append(namePool.GetName(childNode.GetNameId()));
+    if (childNode.GetUnitAddressId() != NamePool::EMPTY_NAME_ID) {
+      paths.push_back('@');
+      paths.append(childNode.GetUnitAddress());
+    }
+    const std::string_view childPath{paths.data() + pathStart,
+                                     paths.size() - pathStart};
+    nodes.emplace(childPath, &childNode);
+    IndexChildNodes(childNode, childPath);
+  }
+}
+
+void PathIndex::MeasureChildNodes(const Node &argNode,
+                                  const std::string::size_type argPathSize,
+                                  std::string::size_type &argNodeQty,
+                                  std::string::size_type &argPathsSize) {
+  for (const auto item : argNode.GetItems()) {
+    if (item->GetType() != Item::Type::NODE) {
+      continue;
+    }
+    const auto &childNode = *static_cast<const Node *>(item);
+    const auto pathSize = argPathSize + 1 + GetNameSize(childNode);
+    ++argNodeQty;
+    argPathsSize += pathSize;
+    MeasureChildNodes(childNode, pathSize, argNodeQty, argPathsSize);
+  }
+}
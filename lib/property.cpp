@@ -22,10 +22,16 @@
  */
 
 #include "property.h"
+#include "fdt.h"
+#include "hash.h"
+#include "lexer.h"
 #include "node.h"
-#include "string_utils.h"
+#include "output_sink.h"
+#include "value_codec.h"
 
-#include <regex>
+#include <algorithm>
+#include <stdexcept>
+#include <typeinfo>
 
 class InvalidPropertyNameException : public std::exception {
   const char *what() const noexcept override;
@@ -35,14 +41,167 @@ const char *InvalidPropertyNameException::what() const noexcept {
   return "Encountered invalid property name on device tree parsing";
 }
 
-static const std::regex propertyNameRegex{"^\\t+([0-9a-zA-Z,._+?#-]+)( = |;)"};
-constexpr std::string::size_type MAXIMUM_PROPERTY_NAME_LENGTH = 31;
-constexpr std::string::size_type MINIMUM_PROPERTY_NAME_LENGTH = 1;
-constexpr auto VALID_PROPERTY_NAME_CHARS =
-    "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ,._+?#-";
+class UnresolvedReferenceException : public std::exception {
+  const char *what() const noexcept override;
+};
+
+const char *UnresolvedReferenceException::what() const noexcept {
+  return "Encountered unresolved reference on property value encoding";
+}
+
+constexpr std::string_view::size_type MAXIMUM_PROPERTY_NAME_LENGTH = 31;
+constexpr std::string_view::size_type MINIMUM_PROPERTY_NAME_LENGTH = 1;
+
+template <typename T>
+static std::pmr::vector<T>
+DecodeCells(const std::string_view argBlobValue,
+            std::pmr::memory_resource *const argResource) {
+  std::pmr::vector<T> cells(argBlobValue.size() / sizeof(T), argResource);
+  const auto bytes =
+      reinterpret_cast<const unsigned char *>(argBlobValue.data());
+  for (typename std::pmr::vector<T>::size_type i = 0; i < cells.size(); ++i) {
+    T cell = 0;
+    for (auto j = 0u; j < sizeof(T); ++j) {
+      cell = static_cast<T>(cell << 8) | bytes[i * sizeof(T) + j];
+    }
+    cells[i] = cell;
+  }
+  return cells;
+}
+
+template <typename T>
+static std::string EncodeCells(const std::pmr::vector<T> &argCells) {
+  std::string blobValue(argCells.size() * sizeof(T), '\0');
+  for (typename std::pmr::vector<T>::size_type i = 0; i < argCells.size();
+       ++i) {
+    for (auto j = 0u; j < sizeof(T); ++j) {
+      blobValue[i * sizeof(T) + j] =
+          static_cast<char>(argCells[i] >> (8 * (sizeof(T) - 1 - j)));
+    }
+  }
+  return blobValue;
+}
+
+// Hash the kind and name of a property, to which the value is added
+static uint64_t HashPropertyName(const HashTag argTag,
+                                 const Property &argProperty) {
+  return HashString(HashNumber(FNV_OFFSET_BASIS, static_cast<uint64_t>(argTag)),
+                    NamePool::GetInstance().GetName(argProperty.GetNameId()));
+}
+
+template <typename T>
+static uint64_t HashCells(uint64_t argHash,
+                          const std::pmr::vector<T> &argCells) {
+  argHash = HashNumber(argHash, argCells.size());
+  for (const auto cell : argCells) {
+    argHash = HashNumber(argHash, cell);
+  }
+  return argHash;
+}
+
+// Compare cell arrays block-wise without data dependent branches inside of a
+// block, which allows the compiler to vectorize the inner loop
+template <typename T>
+static bool CompareCells(const std::pmr::vector<T> &argCells,
+                         const std::pmr::vector<T> &argOtherCells) {
+  constexpr typename std::pmr::vector<T>::size_type BLOCK_SIZE = 64;
+
+  const auto cellQty = argCells.size();
+  if (cellQty != argOtherCells.size()) {
+    return false;
+  }
+
+  const auto cells = argCells.data();
+  const auto otherCells = argOtherCells.data();
+  typename std::pmr::vector<T>::size_type i = 0;
+  for (; i + BLOCK_SIZE <= cellQty; i += BLOCK_SIZE) {
+    T difference = 0;
+    for (auto j = i; j < i + BLOCK_SIZE; ++j) {
+      difference |= cells[j] ^ otherCells[j];
+    }
+    if (difference != 0) {
+      return false;
+    }
+  }
+  T difference = 0;
+  for (; i < cellQty; ++i) {
+    difference |= cells[i] ^ otherCells[i];
+  }
+  return difference == 0;
+}
 
-Property::Property(const std::string &argName, const Node *argParentNode)
-    : Item{argParentNode->GetLevel() + 1, VerifyPropertyName(argName),
+template <typename T>
+static void AppendCells(
+    std::string &argOutput, const std::pmr::vector<T> &argCells,
+    const CellNotations &argCellNotations,
+    const std::pmr::vector<PropertyValuePHandle::Reference> &argReferences =
+        {}) {
+  argOutput.push_back('<');
+  std::pmr::vector<PropertyValuePHandle::Reference>::size_type nextReference =
+      0;
+  for (typename std::pmr::vector<T>::size_type i = 0; i < argCells.size();
+       ++i) {
+    if (i != 0) {
+      argOutput.push_back(' ');
+    }
+    if ((nextReference < argReferences.size()) &&
+        (argReferences[nextReference].cellIndex == i)) {
+      argOutput.push_back('&');
+      argOutput.append(argReferences[nextReference].label);
+      ++nextReference;
+      continue;
+    }
+    AppendCell(argOutput, argCells[i], argCellNotations.Get(i));
+  }
+  argOutput.push_back('>');
+}
+
+// Copy the labels of the given references into the references' memory
+// resource, so that they live as long as the property holding them
+static void CopyReferenceLabels(
+    std::pmr::vector<PropertyValuePHandle::Reference> &argReferences) {
+  const auto resource = argReferences.get_allocator().resource();
+  for (auto &reference : argReferences) {
+    const auto label =
+        static_cast<char *>(resource->allocate(reference.label.size(), 1));
+    std::copy(reference.label.begin(), reference.label.end(), label);
+    reference.label = {label, reference.label.size()};
+  }
+}
+
+CellNotations::CellNotations(const std::string_view argNotations,
+                             std::pmr::memory_resource *const argResource) {
+  if (argNotations.empty() == true) {
+    return;
+  }
+  notation = static_cast<uint8_t>(argNotations.front());
+  if (argNotations.find_first_not_of(argNotations.front()) ==
+      std::string_view::npos) {
+    return;
+  }
+  const auto copiedNotations =
+      static_cast<uint8_t *>(argResource->allocate(argNotations.size(), 1));
+  std::copy(argNotations.begin(), argNotations.end(), copiedNotations);
+  notations = copiedNotations;
+}
+
+CellNotations::CellNotations(const CellNotations &argNotations,
+                             const std::size_t argCellQty,
+                             std::pmr::memory_resource *const argResource)
+    : notation{argNotations.notation} {
+  if (argNotations.notations == nullptr) {
+    return;
+  }
+  const auto copiedNotations =
+      static_cast<uint8_t *>(argResource->allocate(argCellQty, 1));
+  std::copy(argNotations.notations, argNotations.notations + argCellQty,
+            copiedNotations);
+  notations = copiedNotations;
+}
+
+Property::Property(const NamePool::NameId argNameId,
+                   const Node *argParentNode)
+    : Item{argParentNode->GetLevel() + 1, argNameId, NamePool::EMPTY_NAME_ID,
            argParentNode, Type::PROPERTY} {}
 
 Property::~Property() {}
@@ -53,33 +212,106 @@ bool Property::Compare(const Item *argOtherItem) const {
   }
 
   const auto otherProperty = dynamic_cast<const Property *>(argOtherItem);
-  if (nullptr != otherProperty) {
-    return true;
+  if (nullptr == otherProperty) {
+    return false;
   }
 
-  return false;
+  // Properties are only equal if their values are of the same kind
+  if (typeid(*this) != typeid(*otherProperty)) {
+    return false;
+  }
+
+  return true;
 }
 
-std::shared_ptr<Property> Property::Construct(const std::string &argLine,
-                                              const Node *argParentNode) {
-  std::smatch searchMatch;
-  if (std::regex_search(argLine, searchMatch, propertyNameRegex) == false) {
+Property *Property::Construct(const std::string_view argLine,
+                              const Node *argParentNode) {
+  PropertyToken propertyToken;
+  if (ScanPropertyLine(argLine, propertyToken) == false) {
     throw InvalidPropertyNameException{};
   }
-  const auto propertyText{searchMatch.str(1)};
 
-  const auto dividerPos = propertyText.find(" = ");
-  if (dividerPos == std::string::npos) {
-    return std::shared_ptr<Property>(
-        new PropertyEmpty{propertyText, argParentNode});
+  if (propertyToken.hasValue == false) {
+    return Construct(propertyToken.name, std::nullopt, argParentNode);
   }
 
-  return std::shared_ptr<Property>(new PropertyValueString{
-      propertyText.substr(0, dividerPos), argParentNode,
-      propertyText.substr(dividerPos + 3, std::string::npos)});
+  return Construct(propertyToken.name, propertyToken.value, argParentNode);
 }
 
-std::string Property::GetStringRep() const { return GetPrependedTabs() + name; }
+Property *Property::Construct(const std::string_view argName,
+                              const std::optional<std::string_view> argValue,
+                              const Node *argParentNode) {
+  auto &arena = argParentNode->GetArena();
+  const auto nameId = InternPropertyName(argName);
+  if (argValue.has_value() == false) {
+    return arena.Create<PropertyEmpty>(nameId, argParentNode);
+  }
+
+  // Decode the value into a typed representation if possible
+  EncodedValue encodedValue;
+  if (TryEncodeValue(*argValue, encodedValue)) {
+    switch (encodedValue.kind) {
+    case ValueKind::CELLS_32:
+      if (encodedValue.references.empty()) {
+        return arena.Create<PropertyValueU32>(nameId, argParentNode,
+                                              encodedValue.data,
+                                              encodedValue.cellNotations);
+      }
+      return arena.Create<PropertyValuePHandle>(
+          nameId, argParentNode, encodedValue.data, encodedValue.references,
+          encodedValue.cellNotations);
+    case ValueKind::CELLS_64:
+      return arena.Create<PropertyValueU64>(nameId, argParentNode,
+                                            encodedValue.data,
+                                            encodedValue.cellNotations);
+    case ValueKind::STRING_LIST:
+      return arena.Create<PropertyValueStringList>(nameId, argParentNode,
+                                                   encodedValue.data);
+    case ValueKind::OTHER:
+      break;
+    }
+  }
+
+  return arena.Create<PropertyValueString>(nameId, argParentNode, *argValue);
+}
+
+Property *Property::ConstructFromBlob(const std::string_view argName,
+                                      const std::string_view argBlobValue,
+                                      const Node *argParentNode) {
+  auto &arena = argParentNode->GetArena();
+  const auto nameId = InternPropertyName(argName);
+  if (argBlobValue.empty()) {
+    return arena.Create<PropertyEmpty>(nameId, argParentNode);
+  }
+
+  // Guess the value's kind like dtc does on decompilation
+  if (IsPrintableStringList(argBlobValue)) {
+    return arena.Create<PropertyValueStringList>(nameId, argParentNode,
+                                                 argBlobValue);
+  }
+  if (argBlobValue.size() % sizeof(uint32_t) == 0) {
+    return arena.Create<PropertyValueU32>(nameId, argParentNode,
+                                          argBlobValue);
+  }
+
+  return arena.Create<PropertyValueString>(nameId, argParentNode,
+                                           DecodeValue(argBlobValue));
+}
+
+std::string Property::GetValueStringRep() const {
+  std::string resultStr;
+  AppendValueStringRep(resultStr);
+  return resultStr;
+}
+
+void Property::Serialize(OutputSink &argOutputSink) const {
+  argOutputSink.AppendTabs(level);
+  argOutputSink.Append(NamePool::GetInstance().GetName(nameId));
+  argOutputSink.Append(" = ");
+  // The value is formatted right into the output buffer
+  AppendValueStringRep(argOutputSink.GetBuffer());
+  argOutputSink.Append(';');
+}
 
 void Property::Merge(const Item *argOtherItem, bool argAddFromOther,
                      bool argPurgeItemsNotInOther) {
@@ -90,8 +322,13 @@ void Property::Merge(const Item *argOtherItem, bool argAddFromOther,
   Item::Merge(argOtherItem, argAddFromOther, argPurgeItemsNotInOther);
 }
 
-const std::string &
-Property::VerifyPropertyName(const std::string &argPropName) {
+NamePool::NameId
+Property::InternPropertyName(const std::string_view argPropName) {
+  return NamePool::GetInstance().Intern(VerifyPropertyName(argPropName));
+}
+
+std::string_view
+Property::VerifyPropertyName(const std::string_view argPropName) {
   // Property name shall be between 1 and 31 characters long
   if ((argPropName.size() < MINIMUM_PROPERTY_NAME_LENGTH) ||
       (argPropName.size() > MAXIMUM_PROPERTY_NAME_LENGTH)) {
@@ -99,8 +336,7 @@ Property::VerifyPropertyName(const std::string &argPropName) {
   }
 
   // Property name shall consist only of a certain set of characters
-  if (argPropName.find_first_not_of(VALID_PROPERTY_NAME_CHARS) !=
-      std::string::npos) {
+  if (ConsistsOfCharClass(argPropName, CharClass::PROPERTY_NAME) == false) {
     throw InvalidPropertyNameException{};
   }
 
@@ -120,8 +356,14 @@ bool PropertyEmpty::Compare(const Item *argOtherItem) const {
   return false;
 }
 
-std::string PropertyEmpty::GetStringRep() const {
-  return Property::GetStringRep() + ";";
+uint64_t PropertyEmpty::GetHash() const {
+  return HashPropertyName(HashTag::PROPERTY_EMPTY, *this);
+}
+
+void PropertyEmpty::Serialize(OutputSink &argOutputSink) const {
+  argOutputSink.AppendTabs(level);
+  argOutputSink.Append(NamePool::GetInstance().GetName(nameId));
+  argOutputSink.Append(';');
 }
 
 void PropertyEmpty::Merge(const Item *argOtherItem, bool argAddFromOther,
@@ -152,8 +394,16 @@ bool PropertyValueString::Compare(const Item *argOtherItem) const {
   return false;
 }
 
-std::string PropertyValueString::GetStringRep() const {
-  return Property::GetStringRep() + " = " + value + ";";
+std::string PropertyValueString::GetEncodedValue() const {
+  return EncodeValue(value);
+}
+
+uint64_t PropertyValueString::GetHash() const {
+  return HashString(HashPropertyName(HashTag::PROPERTY_STRING, *this), value);
+}
+
+void PropertyValueString::AppendValueStringRep(std::string &argOutput) const {
+  argOutput.append(value);
 }
 
 void PropertyValueString::Merge(const Item *argOtherItem, bool argAddFromOther,
@@ -169,3 +419,233 @@ void PropertyValueString::Merge(const Item *argOtherItem, bool argAddFromOther,
 
   value = otherProperty->value;
 }
+
+bool PropertyValueStringList::Compare(const Item *argOtherItem) const {
+  if (false == Property::Compare(argOtherItem)) {
+    return false;
+  }
+
+  const auto otherProperty =
+      dynamic_cast<const PropertyValueStringList *>(argOtherItem);
+  if (nullptr == otherProperty) {
+    return false;
+  }
+
+  return strings == otherProperty->strings;
+}
+
+std::string PropertyValueStringList::GetEncodedValue() const {
+  return std::string{strings.data(), strings.size()};
+}
+
+uint64_t PropertyValueStringList::GetHash() const {
+  return HashString(HashPropertyName(HashTag::PROPERTY_STRING_LIST, *this),
+                    strings);
+}
+
+std::vector<std::string_view> PropertyValueStringList::GetStrings() const {
+  std::vector<std::string_view> resultStrings;
+  const std::string_view remainingStrings{strings};
+  std::string_view::size_type stringStart = 0;
+  while (stringStart < remainingStrings.size()) {
+    const auto stringEnd = remainingStrings.find('\0', stringStart);
+    resultStrings.emplace_back(
+        remainingStrings.substr(stringStart, stringEnd - stringStart));
+    stringStart = stringEnd + 1;
+  }
+  return resultStrings;
+}
+
+void PropertyValueStringList::AppendValueStringRep(
+    std::string &argOutput) const {
+  AppendQuotedStrings(argOutput, strings);
+}
+
+void PropertyValueStringList::Merge(const Item *argOtherItem,
+                                    bool argAddFromOther,
+                                    bool argPurgeItemsNotInOther) {
+  const auto otherProperty =
+      dynamic_cast<const PropertyValueStringList *>(argOtherItem);
+  if (otherProperty == nullptr) {
+    throw std::invalid_argument{
+        "Try to merge unrelated class into PropertyValueStringList"};
+  }
+
+  Property::Merge(argOtherItem, argAddFromOther, argPurgeItemsNotInOther);
+
+  strings = otherProperty->strings;
+}
+
+PropertyValueU32::PropertyValueU32(const NamePool::NameId argNameId,
+                                   const Node *argParentNode,
+                                   const std::string_view argBlobValue,
+                                   const std::string_view argCellNotations)
+    : Property{argNameId, argParentNode},
+      cells{DecodeCells<uint32_t>(argBlobValue, GetResource(argParentNode))},
+      cellNotations{argCellNotations, GetResource(argParentNode)} {}
+
+bool PropertyValueU32::Compare(const Item *argOtherItem) const {
+  if (false == Property::Compare(argOtherItem)) {
+    return false;
+  }
+
+  const auto otherProperty =
+      dynamic_cast<const PropertyValueU32 *>(argOtherItem);
+  if (nullptr == otherProperty) {
+    return false;
+  }
+
+  return CompareCells(cells, otherProperty->cells);
+}
+
+std::string PropertyValueU32::GetEncodedValue() const {
+  return EncodeCells(cells);
+}
+
+uint64_t PropertyValueU32::GetHash() const {
+  return HashCells(HashPropertyName(HashTag::PROPERTY_U32, *this), cells);
+}
+
+void PropertyValueU32::AppendValueStringRep(std::string &argOutput) const {
+  AppendCells(argOutput, cells, cellNotations);
+}
+
+void PropertyValueU32::Merge(const Item *argOtherItem, bool argAddFromOther,
+                             bool argPurgeItemsNotInOther) {
+  const auto otherProperty =
+      dynamic_cast<const PropertyValueU32 *>(argOtherItem);
+  if (otherProperty == nullptr) {
+    throw std::invalid_argument{
+        "Try to merge unrelated class into PropertyValueU32"};
+  }
+
+  Property::Merge(argOtherItem, argAddFromOther, argPurgeItemsNotInOther);
+
+  cells = otherProperty->cells;
+  cellNotations = CellNotations{otherProperty->cellNotations, cells.size(),
+                                cells.get_allocator().resource()};
+}
+
+PropertyValueU64::PropertyValueU64(const NamePool::NameId argNameId,
+                                   const Node *argParentNode,
+                                   const std::string_view argBlobValue,
+                                   const std::string_view argCellNotations)
+    : Property{argNameId, argParentNode},
+      cells{DecodeCells<uint64_t>(argBlobValue, GetResource(argParentNode))},
+      cellNotations{argCellNotations, GetResource(argParentNode)} {}
+
+bool PropertyValueU64::Compare(const Item *argOtherItem) const {
+  if (false == Property::Compare(argOtherItem)) {
+    return false;
+  }
+
+  const auto otherProperty =
+      dynamic_cast<const PropertyValueU64 *>(argOtherItem);
+  if (nullptr == otherProperty) {
+    return false;
+  }
+
+  return CompareCells(cells, otherProperty->cells);
+}
+
+std::string PropertyValueU64::GetEncodedValue() const {
+  return EncodeCells(cells);
+}
+
+uint64_t PropertyValueU64::GetHash() const {
+  return HashCells(HashPropertyName(HashTag::PROPERTY_U64, *this), cells);
+}
+
+void PropertyValueU64::AppendValueStringRep(std::string &argOutput) const {
+  argOutput.append("/bits/ 64 ");
+  AppendCells(argOutput, cells, cellNotations);
+}
+
+void PropertyValueU64::Merge(const Item *argOtherItem, bool argAddFromOther,
+                             bool argPurgeItemsNotInOther) {
+  const auto otherProperty =
+      dynamic_cast<const PropertyValueU64 *>(argOtherItem);
+  if (otherProperty == nullptr) {
+    throw std::invalid_argument{
+        "Try to merge unrelated class into PropertyValueU64"};
+  }
+
+  Property::Merge(argOtherItem, argAddFromOther, argPurgeItemsNotInOther);
+
+  cells = otherProperty->cells;
+  cellNotations = CellNotations{otherProperty->cellNotations, cells.size(),
+                                cells.get_allocator().resource()};
+}
+
+PropertyValuePHandle::PropertyValuePHandle(
+    const NamePool::NameId argNameId, const Node *argParentNode,
+    const std::string_view argBlobValue,
+    const std::vector<CellReference> &argReferences,
+    const std::string_view argCellNotations)
+    : PropertyValueU32{argNameId, argParentNode, argBlobValue,
+                       argCellNotations},
+      references{GetResource(argParentNode)} {
+  references.reserve(argReferences.size());
+  for (const auto &reference : argReferences) {
+    references.push_back({reference.cellIndex, reference.label});
+  }
+  CopyReferenceLabels(references);
+}
+
+PropertyValuePHandle::PropertyValuePHandle(
+    const PropertyValuePHandle &argProperty, const Node *argParentNode)
+    : PropertyValueU32{argProperty, argParentNode},
+      references{argProperty.references, GetResource(argParentNode)} {
+  CopyReferenceLabels(references);
+}
+
+bool PropertyValuePHandle::Compare(const Item *argOtherItem) const {
+  if (false == PropertyValueU32::Compare(argOtherItem)) {
+    return false;
+  }
+
+  const auto otherProperty =
+      dynamic_cast<const PropertyValuePHandle *>(argOtherItem);
+  if (nullptr == otherProperty) {
+    return false;
+  }
+
+  return references == otherProperty->references;
+}
+
+std::string PropertyValuePHandle::GetEncodedValue() const {
+  // Labels are not resolved to phandle values yet
+  throw UnresolvedReferenceException{};
+}
+
+uint64_t PropertyValuePHandle::GetHash() const {
+  auto hash =
+      HashCells(HashPropertyName(HashTag::PROPERTY_PHANDLE, *this), cells);
+  for (const auto &reference : references) {
+    hash = HashNumber(hash, reference.cellIndex);
+    hash = HashString(hash, reference.label);
+  }
+  return hash;
+}
+
+void PropertyValuePHandle::AppendValueStringRep(
+    std::string &argOutput) const {
+  AppendCells(argOutput, cells, cellNotations, references);
+}
+
+void PropertyValuePHandle::Merge(const Item *argOtherItem,
+                                 bool argAddFromOther,
+                                 bool argPurgeItemsNotInOther) {
+  const auto otherProperty =
+      dynamic_cast<const PropertyValuePHandle *>(argOtherItem);
+  if (otherProperty == nullptr) {
+    throw std::invalid_argument{
+        "Try to merge unrelated class into PropertyValuePHandle"};
+  }
+
+  PropertyValueU32::Merge(argOtherItem, argAddFromOther,
+                          argPurgeItemsNotInOther);
+
+  references = otherProperty->references;
+  CopyReferenceLabels(references);
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Monotonic bump allocator holding all items of a (part of a) device tree.
+// Memory is only released when the arena is destroyed, after the destructors
+// of all objects created by it have been run.
+class Arena {
+public:
+  Arena();
+  Arena(const Arena &argArena) = delete;
+  ~Arena();
+
+  Arena &operator=(const Arena &argArena) = delete;
+
+  template <typename T, typename... Args> T *Create(Args &&... argArgs) {
+    const auto object = new (resource.allocate(sizeof(T), alignof(T)))
+        T{std::forward<Args>(argArgs)...};
+    if constexpr (std::is_trivially_destructible_v<T> == false) {
+      destructors = new (resource.allocate(sizeof(Destructor),
+                                           alignof(Destructor)))
+          Destructor{&DestroyObject<T>, object, destructors};
+    }
+    return object;
+  }
+  std::pmr::memory_resource *GetResource() noexcept { return &resource; }
+
+private:
+  struct Destructor {
+    void (*destroy)(void *argObject);
+    void *object;
+    Destructor *next;
+  };
+
+  template <typename T> static void DestroyObject(void *argObject) {
+    static_cast<T *>(argObject)->~T();
+  }
+
+  std::pmr::monotonic_buffer_resource resource;
+  Destructor *destructors = nullptr;
+};
+
+#endif // ARENA_H
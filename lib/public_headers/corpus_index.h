@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef CORPUS_INDEX_H
+#define CORPUS_INDEX_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class RootNode;
+
+// Groups the device trees of a corpus without comparing all pairs of them.
+// Trees with equal root hashes are identical, because the hashes do not depend
+// on the order of items. Trees whose sets of subtree and property hashes
+// overlap by at least a similarity threshold are near-duplicates. The overlap
+// (Jaccard similarity) is estimated by MinHash signatures and candidate pairs
+// are found by locality-sensitive hashing of bands of the signatures.
+class CorpusIndex {
+public:
+  static constexpr uint32_t BAND_QTY = 16;
+  static constexpr uint32_t ROWS_PER_BAND = 4;
+  static constexpr uint32_t SIGNATURE_SIZE = BAND_QTY * ROWS_PER_BAND;
+  // Pairs of this similarity become candidates with a probability of 99.9 %
+  static constexpr double DEFAULT_SIMILARITY_THRESHOLD = 0.8;
+
+  struct Fingerprint {
+    uint64_t treeHash;
+    std::array<uint64_t, SIGNATURE_SIZE> signature;
+  };
+
+  // Trees which are identical or near-duplicates of each other
+  struct Cluster {
+    // Indices of the trees in groups of identical trees, ordered by index
+    std::vector<std::vector<std::size_t>> groups;
+    // Lowest estimated similarity of near-duplicate groups linked together
+    double similarity = 1.0;
+  };
+
+  static Fingerprint ComputeFingerprint(const RootNode &argRootNode);
+  static double EstimateSimilarity(const Fingerprint &argFingerprint1,
+                                   const Fingerprint &argFingerprint2);
+
+  // Add the fingerprint of a tree and return the tree's index
+  std::size_t Add(const Fingerprint &argFingerprint);
+  // Return the clusters of all added trees ordered by their first tree
+  std::vector<Cluster> GetClusters(
+      double argSimilarityThreshold = DEFAULT_SIMILARITY_THRESHOLD) const;
+
+private:
+  std::vector<Fingerprint> fingerprints;
+};
+
+#endif // CORPUS_INDEX_H
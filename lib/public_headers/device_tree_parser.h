@@ -25,22 +25,45 @@
 #define DEVICE_TREE_PARSER_H
 
 #include <cstdint>
+#include <iostream>
 #include <limits>
 #include <memory>
 #include <string>
+#include <string_view>
 
+class LineReader;
+class ParseCache;
 class RootNode;
+class ThreadPool;
 
 class DeviceTreeParser {
 public:
-  DeviceTreeParser(const std::string &argFilePath);
+  // Trees are loaded from and stored into the parse cache if one is given.
+  // Parsing in parallel runs on the given thread pool or on one of its own.
+  // Failures to read the file are reported on the given error stream.
+  DeviceTreeParser(const std::string &argFilePath,
+                   bool argParseInParallel = false,
+                   const ParseCache *argParseCache = nullptr,
+                   ThreadPool *argThreadPool = nullptr,
+                   std::ostream &argErrorStream = std::cerr);
   ~DeviceTreeParser();
 
   std::unique_ptr<RootNode> ParseFile();
 
 private:
+  std::unique_ptr<RootNode> ParseBuffer(std::string_view argBuffer);
+  std::unique_ptr<RootNode>
+  ParseRootNodeInParallel(std::string_view argLine, LineReader &argLineReader,
+                          std::string_view argBuffer);
+
   const std::string deviceTreeFilePath;
+  std::ostream &errorStream;
+  const bool parseInParallel = false;
+  const ParseCache *const parseCache = nullptr;
+  ThreadPool *const threadPool = nullptr;
   uint_fast8_t deviceTreeVersion = std::numeric_limits<uint_fast8_t>::max();
+
+  friend class WatchedTree;
 };
 
 #endif // DEVICE_TREE_PARSER_H
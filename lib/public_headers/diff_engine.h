@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef DIFF_ENGINE_H
+#define DIFF_ENGINE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Item;
+class Node;
+class RootNode;
+class TaskGroup;
+class ThreadPool;
+
+struct Difference {
+  enum class Type {
+    ADDED,
+    CHANGED,
+    REMOVED,
+  };
+
+  // Return the difference as JSON object on a single line
+  std::string GetJsonLine() const;
+
+  Type type;
+  // Device path of the differing node or of the node holding the property
+  std::string path;
+  // The differing item of the first and of the second tree, nullptr if absent
+  const Item *item1;
+  const Item *item2;
+};
+
+// Collects the differences between two device trees. Subtrees with equal
+// hashes are skipped unless hash matches shall be verified, every other item is
+// visited once. Given a thread pool, subtrees of at least the split threshold's
+// size are diffed as separate tasks. The differences are reported in the same
+// order as without a thread pool, except which difference is found first when
+// stopping at the first difference.
+class DiffEngine {
+public:
+  static constexpr uint32_t DEFAULT_SPLIT_THRESHOLD = 4096;
+
+  DiffEngine(bool argStopAtFirstDifference = false,
+             bool argVerifyHashMatches = false,
+             ThreadPool *argThreadPool = nullptr,
+             uint32_t argSplitThreshold = DEFAULT_SPLIT_THRESHOLD);
+
+  // Return the differences turning the first tree into the second one
+  std::vector<Difference> Diff(const RootNode &argRootNode1,
+                               const RootNode &argRootNode2);
+  // Return the differences below two nodes of the given device path, which
+  // are the same as the ones of this path on diffing the whole trees
+  std::vector<Difference> Diff(const Node &argNode1, const Node &argNode2,
+                               const std::string &argPath);
+
+private:
+  struct Chunk;
+
+  // Return false if no further differences shall be collected
+  bool AddDifference(Chunk &argChunk, Difference::Type argType,
+                     const std::string &argPath, const Item *argItem1,
+                     const Item *argItem2);
+  static void CollectDifferences(Chunk &argChunk,
+                                 std::vector<Difference> &argDifferences);
+  bool DiffNodes(const Node &argNode1, const Node &argNode2,
+                 std::string &argPath, Chunk &argChunk,
+                 TaskGroup *argTaskGroup);
+
+  const bool stopAtFirstDifference;
+  const bool verifyHashMatches;
+  ThreadPool *const threadPool;
+  const uint32_t splitThreshold;
+  std::atomic<bool> stopped{false};
+};
+
+#endif // DIFF_ENGINE_H
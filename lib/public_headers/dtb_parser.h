@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef DTB_PARSER_H
+#define DTB_PARSER_H
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+
+class Node;
+class RootNode;
+
+class DtbParser {
+public:
+  DtbParser(const std::string &argFilePath,
+            std::ostream &argErrorStream = std::cerr);
+  ~DtbParser();
+
+  static bool IsDtbFile(const std::string &argFilePath);
+  std::unique_ptr<RootNode> ParseFile();
+
+private:
+  std::unique_ptr<RootNode> ParseBlob(std::string_view argBlob);
+  void ParseNodeContents(Node &argNode);
+  uint32_t ReadToken();
+  std::string_view ReadNodeName();
+
+  const std::string dtbFilePath;
+  std::ostream &errorStream;
+  std::string_view structBlock;
+  std::string_view stringsBlock;
+  uint32_t structOffset = 0;
+};
+
+#endif // DTB_PARSER_H
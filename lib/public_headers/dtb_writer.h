@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef DTB_WRITER_H
+#define DTB_WRITER_H
+
+#include "name_pool.h"
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+class Node;
+class Property;
+class RootNode;
+
+class DtbWriter {
+public:
+  DtbWriter(const std::string &argFilePath,
+            std::ostream &argErrorStream = std::cerr);
+  ~DtbWriter();
+
+  bool WriteFile(const RootNode &argRootNode);
+
+private:
+  void AppendProperty(NamePool::NameId argNameId, const std::string &argValue);
+  void AppendToken(uint32_t argToken);
+  // Record the labelled nodes and the values of existing "phandle" properties
+  bool CollectLabels(const Node &argNode, uint32_t &argHighestPhandle);
+  // Return the binary value of a property with its references resolved
+  std::string EncodeProperty(const Property &argProperty) const;
+  uint32_t GetStringOffset(NamePool::NameId argNameId);
+  // Map each referenced label (or path in braces) to the phandle of its node.
+  // Referenced nodes without a "phandle" property are assigned the next free
+  // value, for which the property is added on serialization.
+  bool ResolveReferences(const RootNode &argRootNode, const Node &argNode,
+                         uint32_t &argHighestPhandle);
+  void SerializeNode(const Node &argNode);
+
+  const std::string dtbFilePath;
+  std::ostream &errorStream;
+  std::string structBlock;
+  std::string stringsBlock;
+  std::unordered_map<NamePool::NameId, uint32_t> stringOffsets;
+  // Labels of nodes are owned by the name pool, those of references by the
+  // properties holding them
+  std::unordered_map<std::string_view, const Node *> labelledNodes;
+  std::unordered_map<const Node *, uint32_t> phandles;
+  std::unordered_set<const Node *> generatedPhandles;
+  std::unordered_map<std::string_view, uint32_t> referencePhandles;
+};
+
+#endif // DTB_WRITER_H
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// Waits for files to be modified. The directories holding the files are
+// watched with inotify where available, since editors often replace files
+// instead of writing to them. Without inotify the waiting times out regularly,
+// so that the caller can poll the files instead.
+class FileWatcher {
+public:
+  FileWatcher(const std::vector<std::string> &argFilePaths);
+  FileWatcher(const FileWatcher &argFileWatcher) = delete;
+  ~FileWatcher();
+
+  FileWatcher &operator=(const FileWatcher &argFileWatcher) = delete;
+
+  bool IsPolling() const noexcept { return inotifyFd < 0; }
+  // Block until one of the files may have been modified or the given file
+  // descriptor became readable. Return false in the latter case.
+  bool Wait(int argInterruptFd);
+
+private:
+  // Return whether any of the pending events concerns one of the files
+  bool ReadEvents();
+
+  int inotifyFd = -1;
+  std::unordered_set<std::string> fileNames;
+};
+
+#endif // FILE_WATCHER_H
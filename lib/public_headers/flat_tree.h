@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef FLAT_TREE_H
+#define FLAT_TREE_H
+
+#include "name_pool.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class Item;
+class Node;
+class Property;
+class RootNode;
+
+// Read-only structure-of-arrays representation of a device tree. The items are
+// stored in pre-order with the children of each node sorted by kind and name,
+// so that two equal trees have identical arrays regardless of the source order
+// of their items.
+class FlatTree {
+public:
+  using Index = uint32_t;
+
+  enum class Kind : uint8_t {
+    NODE,
+    PROPERTY_EMPTY,
+    PROPERTY_PHANDLE,
+    PROPERTY_STRING,
+    PROPERTY_STRING_LIST,
+    PROPERTY_U32,
+    PROPERTY_U64,
+  };
+
+  static constexpr Index NO_INDEX = UINT32_MAX;
+
+  FlatTree(const RootNode &argRootNode);
+
+  bool Compare(const FlatTree &argOtherTree) const;
+  Index GetFirstChild(Index argIndex) const { return firstChildren[argIndex]; }
+  // Return a hash over all items, which is equal for equal trees
+  uint64_t GetHash() const;
+  Kind GetKind(Index argIndex) const { return kinds[argIndex]; }
+  NamePool::NameId GetNameId(Index argIndex) const { return nameIds[argIndex]; }
+  Index GetNextSibling(Index argIndex) const { return nextSiblings[argIndex]; }
+  Index GetParent(Index argIndex) const { return parents[argIndex]; }
+  Index GetSize() const noexcept { return static_cast<Index>(kinds.size()); }
+  NamePool::NameId GetUnitAddressId(Index argIndex) const {
+    return unitAddressIds[argIndex];
+  }
+  // Return the raw bytes of a property's value (cells in host byte order)
+  std::string_view GetValue(Index argIndex) const;
+
+private:
+  Index AddItem(const Item &argItem, Index argParent);
+  void AddChildren(const Node &argNode, Index argIndex);
+  void AppendValue(const Property &argProperty, Kind &argKind);
+
+  std::vector<Kind> kinds;
+  std::vector<NamePool::NameId> nameIds;
+  std::vector<NamePool::NameId> unitAddressIds;
+  std::vector<Index> parents;
+  std::vector<Index> firstChildren;
+  std::vector<Index> nextSiblings;
+  // Item i's value is located in [valueOffsets[i], valueOffsets[i + 1])
+  std::vector<Index> valueOffsets;
+  std::string values;
+};
+
+#endif // FLAT_TREE_H
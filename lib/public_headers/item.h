@@ -24,8 +24,15 @@
 #ifndef ITEM_H
 #define ITEM_H
 
-#include <memory>
+#include "name_pool.h"
+
+#include <cstdint>
+#include <iostream>
 #include <string>
+#include <string_view>
+
+class Node;
+class OutputSink;
 
 class Item {
 public:
@@ -35,39 +42,70 @@ public:
     ROOT_NODE,
   };
 
-  using SharedPtrItem = std::shared_ptr<Item>;
-  using SharedPtrConstItem = std::shared_ptr<const Item>;
-
   virtual ~Item();
 
   virtual bool Compare(const Item *argOtherItem) const = 0;
+  // Return a hash of the item's content, which is equal for all items comparing
+  // equal. It is independent of the order of items within nodes.
+  virtual uint64_t GetHash() const = 0;
   uint_fast16_t GetLevel() const noexcept { return level; }
-  virtual std::string GetName() const { return name; }
+  virtual std::string GetName() const {
+    return NamePool::GetInstance().GetName(nameId);
+  }
+  NamePool::NameId GetNameId() const noexcept { return nameId; }
   Type GetType() const noexcept { return type; }
-  virtual std::string GetStringRep() const = 0;
+  NamePool::NameId GetUnitAddressId() const noexcept { return unitAddressId; }
+  // Return the item's device tree source representation
+  std::string GetStringRep() const;
+  bool HasSameName(const Item &argOtherItem) const noexcept {
+    return (nameId == argOtherItem.nameId) &&
+           (unitAddressId == argOtherItem.unitAddressId);
+  }
   bool IsSameType(const Item &argOtherItem) const noexcept {
     return type == argOtherItem.type;
   }
+  // Return whether the item is part of more than one tree, in which case it
+  // must be copied instead of being modified
+  bool IsShared() const noexcept { return shared; }
   virtual void Merge(const Item *argOtherItem, bool argAddFromOther,
                      bool argPurgeItemsNotInOther) = 0;
-  void Print() const;
+  void Print(std::ostream &argOutputStream = std::cout) const;
+  // Write the item's device tree source representation
+  virtual void Serialize(OutputSink &argOutputSink) const = 0;
 
 protected:
-  Item(uint_fast16_t argLevel, const std::string &argName,
-       const Item *argParent, Type argType)
-      : level{argLevel}, name{argName}, parent{argParent}, type{argType} {}
-  Item(const Item &argItem) = default;
-  Item &operator=(const Item &argItem) = default;
-
-  std::string GetPrependedTabs() const;
+  Item(uint_fast16_t argLevel, NamePool::NameId argNameId,
+       NamePool::NameId argUnitAddressId, const Item *argParent, Type argType)
+      : level{argLevel}, nameId{argNameId}, unitAddressId{argUnitAddressId},
+        parent{argParent}, type{argType} {}
+  // Copy an item to be placed below the given parent
+  Item(const Item &argItem, const Item *argParent)
+      : level{static_cast<uint_fast16_t>(argParent ? argParent->level + 1
+                                                   : 0u)},
+        nameId{argItem.nameId}, unitAddressId{argItem.unitAddressId},
+        parent{argParent}, type{argItem.type} {}
+  Item(const Item &argItem) = delete;
+  Item &operator=(const Item &argItem) = delete;
 
   const uint_fast16_t level = 0;
-  const std::string name;
+  const NamePool::NameId nameId = NamePool::EMPTY_NAME_ID;
+  // Only nodes can have a unit address
+  const NamePool::NameId unitAddressId = NamePool::EMPTY_NAME_ID;
+  // The parent in the tree the item was created in, which for shared items
+  // may be freed along with that tree
   const Item *const parent = nullptr;
   const Type type;
+
+private:
+  // Only ever set and never reset again, as the item may still be referenced
+  // by another tree
+  mutable bool shared = false;
+
+  friend class Node;
+  friend class WatchSession;
 };
 
-Item::SharedPtrItem
-CopySharedPtrItem(const Item::SharedPtrConstItem &argSharedPtrConstItem);
+// Deeply copy an item into the arena of the given parent node
+Item *CloneItem(const Item *argItem, const Node *argParentNode);
 
 #endif // ITEM_H
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef JSON_H
+#define JSON_H
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// A JSON value read as a whole by JsonReader::ReadValue. Numbers are kept as
+// their source text to be converted by the user into the type required.
+struct JsonValue {
+  enum class Type {
+    ARRAY,
+    FALSE,
+    NULL_VALUE,
+    NUMBER,
+    OBJECT,
+    STRING,
+    TRUE,
+  };
+
+  Type type = Type::NULL_VALUE;
+  // The contents of strings or the text of numbers
+  std::string text;
+  std::vector<JsonValue> elements;
+  std::vector<std::pair<std::string, JsonValue>> members;
+};
+
+// Pull parser reading a JSON document piece by piece, so that large documents
+// can be processed without building a JsonValue for all of it. Objects and
+// arrays are entered with BeginObject and BeginArray and their entries are
+// iterated with NextMember and NextElement, which return false after consuming
+// the closing bracket.
+class JsonReader {
+public:
+  JsonReader(std::string_view argInput) : input{argInput} {}
+
+  void BeginArray() { Begin('['); }
+  void BeginObject() { Begin('{'); }
+  // Throw if anything but whitespace follows the document
+  void Finish();
+  bool NextElement() { return Next(']'); }
+  // Read the name of the next member, after which its value has to be read
+  bool NextMember(std::string &argName);
+  // Return the type of the next value without reading it
+  JsonValue::Type PeekType();
+  std::string ReadString();
+  // Read the next value completely, which is meant for small values only
+  JsonValue ReadValue();
+
+private:
+  void Begin(char argOpeningChar);
+  bool Next(char argClosingChar);
+
+  std::string_view input;
+  unsigned depth = 0;
+  // Whether no entry of the innermost object or array has been read yet
+  bool isAtFirstEntry = false;
+};
+
+// Append a string escaped for use inside of a JSON string, but without quotes
+void AppendEscapedJsonString(std::string &argOutput,
+                             std::string_view argInputStr);
+// Append a string as quoted and escaped JSON string
+void AppendJsonString(std::string &argOutput, std::string_view argInputStr);
+
+#endif // JSON_H
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef JSON_PARSER_H
+#define JSON_PARSER_H
+
+#include <iostream>
+#include <memory>
+#include <string>
+
+class JsonReader;
+class Node;
+class RootNode;
+
+// Reads device trees exported by JsonWriter as single document back in. The
+// nodes are created while reading the document instead of building a JsonValue
+// for all of it, which requires the "node" and "property" members to come first
+// in their objects like JsonWriter writes them.
+class JsonParser {
+public:
+  JsonParser(const std::string &argFilePath,
+             std::ostream &argErrorStream = std::cerr);
+  ~JsonParser();
+
+  static bool IsJsonFile(const std::string &argFilePath);
+  std::unique_ptr<RootNode> ParseFile();
+
+private:
+  // Read the remaining members of the node object after its "node" member
+  static void ParseNodeMembers(JsonReader &argReader, Node &argNode);
+  // Read the objects of an "items" array and add them to the node
+  static void ParseNodeItems(JsonReader &argReader, Node &argNode);
+  // Read the remaining members of a property object after its "property"
+  // member, convert its value back into its device tree source representation
+  // and add the property to the node
+  static void ParseProperty(JsonReader &argReader, Node &argNode);
+
+  const std::string jsonFilePath;
+  std::ostream &errorStream;
+};
+
+#endif // JSON_PARSER_H
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <ostream>
+#include <string>
+
+class Node;
+class OutputSink;
+class Property;
+class RootNode;
+
+// Exports a device tree as JSON in a single traversal, writing straight into
+// a buffered sink. Cells are exported as numbers and string lists as arrays,
+// so that the output can be processed without parsing device tree source
+// syntax.
+class JsonWriter {
+public:
+  enum class Format {
+    // A single document of nested node objects which keep the item order
+    DOCUMENT,
+    // One object per node holding its path and its properties per line
+    NODE_LINES,
+  };
+
+  JsonWriter(std::ostream &argOutputStream, Format argFormat);
+
+  void Write(const RootNode &argRootNode);
+
+private:
+  static void WriteNode(OutputSink &argOutputSink, const Node &argNode);
+  // Write the node's line and those of all nodes below it. The path buffer
+  // holds the node's path and is extended by the child nodes' names.
+  static void WriteNodeLines(OutputSink &argOutputSink, const Node &argNode,
+                             std::string &argPath);
+  static void WriteProperty(OutputSink &argOutputSink,
+                            const Property &argProperty);
+
+  std::ostream &outputStream;
+  const Format format;
+};
+
+#endif // JSON_WRITER_H
@@ -24,10 +24,11 @@
 #ifndef LABEL_H
 #define LABEL_H
 
-#include <string>
+#include <string_view>
 
 class Label {
-    static void VerifyLabel(const std::string &argLabel);
+public:
+  static void VerifyLabel(std::string_view argLabel);
 };
 
 #endif // LABEL_H
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef NAME_POOL_H
+#define NAME_POOL_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Process-wide pool of interned node names, unit addresses and property names.
+// Interned names are never released, so their IDs can be shared among all
+// trees and compared instead of the names themselves. Hence the pool grows with
+// the distinct names of all trees parsed by the process, which is why values
+// like referenced labels are not interned.
+class NamePool {
+public:
+  using NameId = uint32_t;
+
+  // ID of the empty name, e.g. the unit address of nodes without one
+  static constexpr NameId EMPTY_NAME_ID = 0;
+
+  NamePool(const NamePool &argNamePool) = delete;
+  NamePool &operator=(const NamePool &argNamePool) = delete;
+
+  static NamePool &GetInstance();
+
+  const std::string &GetName(NameId argNameId) const noexcept {
+    return chunks[argNameId / CHUNK_SIZE].load(std::memory_order_acquire)
+        [argNameId % CHUNK_SIZE];
+  }
+  NameId Intern(std::string_view argName);
+
+private:
+  static constexpr NameId CHUNK_SIZE = 4096;
+  static constexpr NameId MAX_CHUNK_QTY = 16384;
+
+  NamePool();
+
+  // Names are stored in fixed-size chunks which never move, which allows
+  // looking up names by ID without locking
+  std::array<std::atomic<std::string *>, MAX_CHUNK_QTY> chunks{};
+  std::array<std::unique_ptr<std::string[]>, MAX_CHUNK_QTY> ownedChunks;
+  NameId nameQty = 0;
+  std::unordered_map<std::string_view, NameId> nameIds;
+  mutable std::shared_mutex mutex;
+};
+
+#endif // NAME_POOL_H
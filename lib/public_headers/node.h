@@ -26,34 +26,129 @@
 
 #include "item.h"
 
-#include <sstream>
+#include <cstdint>
+#include <memory_resource>
+#include <utility>
 #include <vector>
 
+class Arena;
+class LineReader;
+
 class Node : public Item {
 public:
-  Node(const std::string &argLine, std::istringstream &argInStream,
-       const Node *argParentNode);
-  Node(const Node &argNode);
-  Node &operator=(const Node &argNode);
+  Node(std::string_view argLine, LineReader &argLineReader,
+       const Node *argParentNode, Arena &argArena);
+  // Deeply copy a node to be placed below the given parent node
+  Node(const Node &argNode, const Node *argParentNode);
+  // Shallowly copy a node to be placed below the given parent node, sharing
+  // its items with the copied node
+  struct ShareItems {};
+  Node(const Node &argNode, const Node *argParentNode, ShareItems);
+  Node(const Node &argNode) = delete;
+  Node &operator=(const Node &argNode) = delete;
 
+  // Nodes with differing hashes are unequal right away and nodes with equal
+  // hashes are considered equal without comparing their items
   bool Compare(const Item *argOtherItem) const override;
+  // Like Compare, but additionally verify equal hashes by comparing all items
+  bool CompareVerified(const Item *argOtherItem) const;
+  // Return the first item with the given name and unit address or nullptr
+  const Item *FindItem(NamePool::NameId argNameId,
+                       NamePool::NameId argUnitAddressId) const;
+  // Like FindItem, but only return a property or only a child node
+  const Item *FindItem(NamePool::NameId argNameId,
+                       NamePool::NameId argUnitAddressId,
+                       bool argIsProperty) const;
+  // Return the node's label, which is not part of its content and hence
+  // neither hashed nor compared
+  const std::string &GetLabel() const noexcept {
+    return NamePool::GetInstance().GetName(labelId);
+  }
+  NamePool::NameId GetLabelId() const noexcept { return labelId; }
+  // Return the arena holding the items below this node
+  Arena &GetArena() const noexcept { return arena; }
+  // Return the path by walking up the parents, which is only valid for nodes
+  // created in the tree at hand. Nodes shared from another tree keep their
+  // parents of that tree, so the path has to be passed down instead.
   std::string GetDevicePath() const;
+  uint64_t GetHash() const noexcept override { return hash; }
+  const std::pmr::vector<Item *> &GetItems() const noexcept { return items; }
   std::string GetName() const override;
-  const std::string &GetUnitAddress() const noexcept { return unitAddress; }
-  static bool IsNodeEndLine(const std::string &argLine);
-  static bool IsNodeStartLine(const std::string &argLine);
+  // Return the number of items in the subtree including the node itself
+  uint32_t GetSubtreeSize() const noexcept { return subtreeSize; }
+  const std::string &GetUnitAddress() const noexcept {
+    return NamePool::GetInstance().GetName(unitAddressId);
+  }
+  static bool IsNodeEndLine(std::string_view argLine);
+  static bool IsNodeStartLine(std::string_view argLine);
   void Merge(const Item *argOtherItem, bool argAddFromOther,
              bool argPurgeItemsNotInOther) override;
 
 protected:
-  std::string GetStringRep() const override;
+  Node(std::string_view argName, std::string_view argUnitAddress,
+       const Node *argParentNode, Arena &argArena);
+  // Construct a node from an already verified and interned name
+  Node(NamePool::NameId argNameId, NamePool::NameId argUnitAddressId,
+       const Node *argParentNode, Arena &argArena);
+
+  void Serialize(OutputSink &argOutputSink) const override;
 
 private:
-  static const std::string &VerifyNodeName(bool argIsRootNode,
-                                           const std::string &argNodeName);
+  struct ChildKey {
+    NamePool::NameId nameId;
+    NamePool::NameId unitAddressId;
+    // Position of the item in "items"
+    uint32_t position;
+  };
+  using ChildKeyIterator = std::pmr::vector<ChildKey>::const_iterator;
+
+  // Return the given item of another tree for adding it to this node. Nodes
+  // are shared between the trees, unless their depth differs.
+  Item *ShareItem(const Item *argItem) const;
+  // Return a copy of a shared item of this node which can be modified
+  Item *UnshareItem(const Item *argItem) const;
+  // Sort the positions of the items by name, which must be done whenever the
+  // items changed
+  void BuildChildIndex();
+  // Return the keys of all items with the given name in source order
+  std::pair<ChildKeyIterator, ChildKeyIterator>
+  FindChildKeys(NamePool::NameId argNameId,
+                NamePool::NameId argUnitAddressId) const;
+  // Return the position in "items" of the first property or child node with
+  // the given name or nullptr. Positions which have been cleared to remove
+  // their item before rebuilding the child index are skipped.
+  Item **FindItemSlot(NamePool::NameId argNameId,
+                      NamePool::NameId argUnitAddressId, bool argIsProperty);
+  // Compute the hash from the node's name and its items' hashes and update the
+  // subtree size, which must be done after building the child index and
+  // whenever item values changed
+  void UpdateHash();
+  static NamePool::NameId InternLabel(std::string_view argLabel);
+  static std::string_view VerifyNodeName(bool argIsRootNode,
+                                        std::string_view argNodeName);
+
+  Arena &arena;
+  // The items are owned by the arena, which frees them all at once
+  std::pmr::vector<Item *> items;
+  std::pmr::vector<ChildKey> childIndex;
+  uint64_t hash = 0;
+  uint32_t subtreeSize = 1;
+  NamePool::NameId labelId = NamePool::EMPTY_NAME_ID;
+  // Whether any node of the subtree holds multiple items of the same name
+  bool hasDuplicateNames = false;
 
-  std::vector<SharedPtrItem> items;
-  const std::string unitAddress;
+  friend Arena;
+  friend class DeviceTreeParser;
+  friend class DtbParser;
+  friend class DtbWriter;
+  friend class JsonParser;
+  friend class OverlayApplier;
+  friend class ParseCache;
+  friend class PatchApplier;
+  friend class PathIndex;
+  friend class ThreeWayMerge;
+  friend class WatchSession;
+  friend class WatchedTree;
 };
 
 #endif // NODE_H
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef OVERLAY_APPLIER_H
+#define OVERLAY_APPLIER_H
+
+#include "name_pool.h"
+
+#include <iostream>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class Node;
+class RootNode;
+
+// Applies device tree overlays to a base tree. Each child node of an overlay's
+// root node holding an "__overlay__" node is a fragment, whose "__overlay__"
+// node is merged into the node given by the fragment's "target" label
+// reference or "target-path" property. The labels of the base tree are indexed
+// once, so that applying an overlay only walks the nodes it touches and the
+// paths to its targets.
+class OverlayApplier {
+public:
+  explicit OverlayApplier(RootNode &argBaseRootNode,
+                          std::ostream &argErrorStream = std::cerr);
+
+  // Apply the fragments of an overlay in order. Return false if the target of
+  // a fragment cannot be found, in which case the preceding fragments remain
+  // applied.
+  bool Apply(const RootNode &argOverlayRootNode);
+
+private:
+  struct PathElement {
+    NamePool::NameId nameId;
+    NamePool::NameId unitAddressId;
+  };
+  using NodePath = std::vector<PathElement>;
+
+  // Record the paths of all labelled nodes below the given node, whose path is
+  // given
+  void IndexLabels(const Node &argNode, NodePath &argPath);
+  // Merge the items of a fragment's "__overlay__" node into the target node,
+  // replacing properties and recursing into nodes of equal names
+  static void MergeOverlayNode(Node &argNode, const Node &argOverlayNode);
+  bool ResolveTarget(const Node &argFragmentNode, NodePath &argPath) const;
+
+  RootNode &baseRootNode;
+  std::ostream &errorStream;
+  // Paths of the labelled nodes of the base tree and of the applied overlays.
+  // The labels are owned by the name pool.
+  std::unordered_map<std::string_view, NodePath> labelPaths;
+};
+
+#endif // OVERLAY_APPLIER_H
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef PARSE_CACHE_H
+#define PARSE_CACHE_H
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+
+class EntryReader;
+class EntryWriter;
+class Node;
+class RootNode;
+
+// Directory of parsed device trees in a compact binary form, keyed by a hash of
+// the source text they have been parsed from. Entries are replaced atomically,
+// so any number of processes may read and write the same directory at once.
+class ParseCache {
+public:
+  struct Key {
+    uint64_t sourceHash;
+    uint64_t sourceSize;
+  };
+
+  ParseCache(const std::string &argDirectoryPath);
+  ~ParseCache();
+
+  static Key GetKey(std::string_view argSource) noexcept;
+  // Return the tree cached for the given key or nullptr if there is no valid
+  // entry for it. As the cache may be shared by concurrent parsers, the error
+  // stream is given by each of them.
+  std::unique_ptr<RootNode>
+  Load(const Key &argKey, std::ostream &argErrorStream = std::cerr) const;
+  bool Store(const Key &argKey, const RootNode &argRootNode,
+             std::ostream &argErrorStream = std::cerr) const;
+
+private:
+  static void DeserializeNodeContents(EntryReader &argEntryReader,
+                                      Node &argNode);
+  std::string GetEntryPath(const Key &argKey) const;
+  static void SerializeNode(const Node &argNode, EntryWriter &argEntryWriter);
+
+  const std::string directoryPath;
+};
+
+#endif // PARSE_CACHE_H
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef PATCH_H
+#define PATCH_H
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct Difference;
+class LineReader;
+class Node;
+class RootNode;
+
+// Patches are text files holding the differences turning one tree into
+// another, to be applied later without the second tree. After a header giving
+// the format version and the hashes of both trees, each line holds an
+// operation, the device path of the node it applies to and, separated by a
+// tab, the item in device tree source syntax:
+//
+//   + /soc	serial@3000 {       add a node, followed by its items and "};"
+//   + /soc/i2c@2000	status = "okay";       add a property
+//   = /soc/i2c@2000	clock-frequency = <0x61a80>;       replace a property
+//   - /soc/i2c@2000	dmas;       remove a property
+//   - /soc	spi@4000 {};       remove a node
+class PatchWriter {
+public:
+  PatchWriter(const std::string &argFilePath,
+              std::ostream &argErrorStream = std::cerr);
+
+  // Write the differences turning the first tree into the second one
+  bool WriteFile(const RootNode &argRootNode1, const RootNode &argRootNode2,
+                 const std::vector<Difference> &argDifferences);
+
+private:
+  const std::string patchFilePath;
+  std::ostream &errorStream;
+};
+
+// Applies a patch to a tree in place. Only the nodes on the paths of the
+// patch's operations are visited and the child indices and hashes of the
+// modified nodes are updated once after all operations.
+class PatchApplier {
+public:
+  PatchApplier(const std::string &argFilePath,
+               std::ostream &argErrorStream = std::cerr);
+
+  // Return false if the patch cannot be read, does not belong to the tree or
+  // does not result in the expected tree
+  bool ApplyFile(RootNode &argRootNode);
+
+private:
+  bool ApplyLines(LineReader &argLineReader, RootNode &argRootNode);
+  // Return the node of the given path, which is copied first if it is shared,
+  // or nullptr
+  Node *FindNode(std::string_view argPath, RootNode &argRootNode);
+  // Compact the item lists of the modified nodes and update their child
+  // indices and hashes bottom-up
+  void UpdateModifiedNodes();
+
+  const std::string patchFilePath;
+  std::ostream &errorStream;
+  // All nodes visited by operations, and whether their items changed
+  std::unordered_map<Node *, bool> modifiedNodes;
+  // The node found last, as consecutive operations mostly share their path
+  std::string lastPath;
+  Node *lastNode = nullptr;
+};
+
+#endif // PATCH_H
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef PATH_INDEX_H
+#define PATH_INDEX_H
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+class Node;
+class RootNode;
+
+// Maps the device paths of all nodes of a tree to the nodes. The paths are
+// built once and stored back to back in a single buffer. Like on walking the
+// tree by name, a path of multiple nodes of the same name refers to the first
+// one. The index must not be used anymore once the tree has been modified.
+class PathIndex {
+public:
+  explicit PathIndex(const RootNode &argRootNode);
+
+  // Return the node with the given device path (e.g. "/soc/serial@12340000")
+  // or nullptr
+  const Node *Find(std::string_view argPath) const;
+  std::unordered_map<std::string_view, const Node *>::size_type
+  GetSize() const noexcept {
+    return nodes.size();
+  }
+
+private:
+  // Add the paths of the node's child nodes, which reference the node's path
+  void IndexChildNodes(const Node &argNode, std::string_view argPath);
+  // Count the nodes below the given node and the total size of their paths
+  static void MeasureChildNodes(const Node &argNode,
+                                std::string::size_type argPathSize,
+                                std::string::size_type &argNodeQty,
+                                std::string::size_type &argPathsSize);
+
+  std::string paths;
+  std::unordered_map<std::string_view, const Node *> nodes;
+};
+
+#endif // PATH_INDEX_H
@@ -21,72 +21,292 @@
  * SOFTWARE.
  */
 
+#ifndef PROPERTY_H
+#define PROPERTY_H
+
+#include "arena.h"
 #include "item.h"
 #include "node.h"
 
-#include <memory>
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct CellReference;
+
+// The notations of the cells of a value in device tree source, so that the
+// value is printed like it was given. Only values mixing notations store one
+// per cell.
+class CellNotations {
+public:
+  CellNotations() = default;
+  // Take one notation byte for each cell or a single one for all of them
+  CellNotations(std::string_view argNotations,
+                std::pmr::memory_resource *argResource);
+  // Copy the notations of a value with the given number of cells
+  CellNotations(const CellNotations &argNotations, std::size_t argCellQty,
+                std::pmr::memory_resource *argResource);
+
+  uint8_t Get(const std::size_t argCellIndex) const noexcept {
+    return (notations == nullptr) ? notation : notations[argCellIndex];
+  }
+  bool IsUniform() const noexcept { return notations == nullptr; }
+
+private:
+  // The notation in which dtc decompiles cells, if there is no other one
+  uint8_t notation = 0;
+  // One notation per cell, allocated from the value's memory resource
+  const uint8_t *notations = nullptr;
+};
 
+// Properties and their values are allocated in the arena of their parent node
 class Property : public Item {
 public:
-  static std::shared_ptr<Property> Construct(const std::string &argLine,
-                                             const Node *argParentNode);
+  // The types of values, each of which is held by one of the derived classes
+  enum class ValueType : uint8_t {
+    EMPTY,
+    PHANDLE,
+    STRING,
+    STRING_LIST,
+    U32,
+    U64,
+  };
+
+  static Property *Construct(std::string_view argLine,
+                             const Node *argParentNode);
+  static Property *Construct(std::string_view argName,
+                             std::optional<std::string_view> argValue,
+                             const Node *argParentNode);
+  static Property *ConstructFromBlob(std::string_view argName,
+                                     std::string_view argBlobValue,
+                                     const Node *argParentNode);
   ~Property() override;
 
   bool Compare(const Item *argOtherItem) const override = 0;
+  // Return the value in its binary (FDT) representation
+  virtual std::string GetEncodedValue() const = 0;
+  // Return the value in its device tree source representation
+  std::string GetValueStringRep() const;
+  // Return the type of the value, by which the property can be cast to its
+  // derived class instead of trying each of them
+  virtual ValueType GetValueType() const noexcept = 0;
+  virtual void AppendValueStringRep(std::string &argOutput) const = 0;
   void Merge(const Item *argOtherItem, bool argAddFromOther,
              bool argPurgeItemsNotInOther) override = 0;
 
 protected:
-  Property(const std::string &argName, const Node *argParentNode);
-  Property(const Property &argItem) = default;
-  Property &operator=(const Property &argItem) = default;
+  Property(NamePool::NameId argNameId, const Node *argParentNode);
+  // Copy a property to be placed below the given parent node
+  Property(const Property &argProperty, const Node *argParentNode)
+      : Item{argProperty, argParentNode} {}
 
-  std::string GetStringRep() const override;
+  static std::pmr::memory_resource *
+  GetResource(const Node *const argParentNode) {
+    return argParentNode->GetArena().GetResource();
+  }
+  // Print the property as "name = value;"
+  void Serialize(OutputSink &argOutputSink) const override;
 
 private:
-  static const std::string &VerifyPropertyName(const std::string &argPropName);
+  static NamePool::NameId InternPropertyName(std::string_view argPropName);
+  static std::string_view VerifyPropertyName(std::string_view argPropName);
 };
 
 class PropertyEmpty : public Property {
 public:
+  PropertyEmpty(const PropertyEmpty &argProperty, const Node *argParentNode)
+      : Property{argProperty, argParentNode} {}
+
   bool Compare(const Item *argOtherItem) const override;
+  std::string GetEncodedValue() const override { return {}; }
+  uint64_t GetHash() const override;
+  ValueType GetValueType() const noexcept override { return ValueType::EMPTY; }
+  void AppendValueStringRep(std::string &argOutput) const override {
+    (void)argOutput;
+  }
   void Merge(const Item *argOtherItem, bool argAddFromOther,
              bool argPurgeItemsNotInOther) override;
 
 protected:
-  std::string GetStringRep() const override;
+  void Serialize(OutputSink &argOutputSink) const override;
 
 private:
-  PropertyEmpty(const std::string &argName, const Node *argParentNode)
-      : Property(argName, argParentNode) {}
+  PropertyEmpty(NamePool::NameId argNameId, const Node *argParentNode)
+      : Property(argNameId, argParentNode) {}
 
-  friend Property;
+  friend Arena;
 };
 
+// A value which has no typed representation and is kept as source text
 class PropertyValueString : public Property {
 public:
+  PropertyValueString(const PropertyValueString &argProperty,
+                      const Node *argParentNode)
+      : Property{argProperty, argParentNode},
+        value{argProperty.value, GetResource(argParentNode)} {}
+
   bool Compare(const Item *argOtherItem) const override;
-  const std::string &GetValue() const noexcept { return value; }
+  std::string GetEncodedValue() const override;
+  uint64_t GetHash() const override;
+  std::string_view GetValue() const noexcept { return value; }
+  ValueType GetValueType() const noexcept override { return ValueType::STRING; }
+  void AppendValueStringRep(std::string &argOutput) const override;
+  void Merge(const Item *argOtherItem, bool argAddFromOther,
+             bool argPurgeItemsNotInOther) override;
+
+private:
+  PropertyValueString(NamePool::NameId argNameId, const Node *argParentNode,
+                      std::string_view argValue)
+      : Property{argNameId, argParentNode},
+        value{argValue, GetResource(argParentNode)} {}
+
+  std::pmr::string value;
+
+  friend Arena;
+};
+
+// A list of one or more strings (e.g. '"foo", "bar"')
+class PropertyValueStringList : public Property {
+public:
+  PropertyValueStringList(const PropertyValueStringList &argProperty,
+                          const Node *argParentNode)
+      : Property{argProperty, argParentNode},
+        strings{argProperty.strings, GetResource(argParentNode)} {}
+
+  bool Compare(const Item *argOtherItem) const override;
+  std::string GetEncodedValue() const override;
+  uint64_t GetHash() const override;
+  std::vector<std::string_view> GetStrings() const;
+  ValueType GetValueType() const noexcept override {
+    return ValueType::STRING_LIST;
+  }
+  void AppendValueStringRep(std::string &argOutput) const override;
+  void Merge(const Item *argOtherItem, bool argAddFromOther,
+             bool argPurgeItemsNotInOther) override;
+
+private:
+  PropertyValueStringList(NamePool::NameId argNameId, const Node *argParentNode,
+                          std::string_view argStrings)
+      : Property{argNameId, argParentNode},
+        strings{argStrings, GetResource(argParentNode)} {}
+
+  // All strings, each one followed by a terminating null character
+  std::pmr::string strings;
+
+  friend Arena;
+};
+
+// A list of 32 bit cells (e.g. "<0x1 0x2>")
+class PropertyValueU32 : public Property {
+public:
+  PropertyValueU32(const PropertyValueU32 &argProperty,
+                   const Node *argParentNode)
+      : Property{argProperty, argParentNode},
+        cells{argProperty.cells, GetResource(argParentNode)},
+        cellNotations{argProperty.cellNotations, argProperty.cells.size(),
+                      GetResource(argParentNode)} {}
+
+  bool Compare(const Item *argOtherItem) const override;
+  const CellNotations &GetCellNotations() const noexcept {
+    return cellNotations;
+  }
+  const std::pmr::vector<uint32_t> &GetCells() const noexcept { return cells; }
+  std::string GetEncodedValue() const override;
+  uint64_t GetHash() const override;
+  ValueType GetValueType() const noexcept override { return ValueType::U32; }
+  void AppendValueStringRep(std::string &argOutput) const override;
   void Merge(const Item *argOtherItem, bool argAddFromOther,
              bool argPurgeItemsNotInOther) override;
 
 protected:
-  std::string GetStringRep() const override;
+  // Decode the cells from their binary (FDT) representation
+  PropertyValueU32(NamePool::NameId argNameId, const Node *argParentNode,
+                   std::string_view argBlobValue,
+                   std::string_view argCellNotations = {});
+
+  std::pmr::vector<uint32_t> cells;
+  CellNotations cellNotations;
+
+private:
+  friend Arena;
+};
+
+// A list of 64 bit cells (e.g. "/bits/ 64 <0x1 0x2>")
+class PropertyValueU64 : public Property {
+public:
+  PropertyValueU64(const PropertyValueU64 &argProperty,
+                   const Node *argParentNode)
+      : Property{argProperty, argParentNode},
+        cells{argProperty.cells, GetResource(argParentNode)},
+        cellNotations{argProperty.cellNotations, argProperty.cells.size(),
+                      GetResource(argParentNode)} {}
+
+  bool Compare(const Item *argOtherItem) const override;
+  const CellNotations &GetCellNotations() const noexcept {
+    return cellNotations;
+  }
+  const std::pmr::vector<uint64_t> &GetCells() const noexcept { return cells; }
+  std::string GetEncodedValue() const override;
+  uint64_t GetHash() const override;
+  ValueType GetValueType() const noexcept override { return ValueType::U64; }
+  void AppendValueStringRep(std::string &argOutput) const override;
+  void Merge(const Item *argOtherItem, bool argAddFromOther,
+             bool argPurgeItemsNotInOther) override;
 
 private:
-  PropertyValueString(const std::string &argName, const Node *argParentNode,
-                      const std::string &argValue)
-      : Property{argName, argParentNode}, value{argValue} {}
+  // Decode the cells from their binary (FDT) representation
+  PropertyValueU64(NamePool::NameId argNameId, const Node *argParentNode,
+                   std::string_view argBlobValue,
+                   std::string_view argCellNotations = {});
 
-  std::string value;
+  std::pmr::vector<uint64_t> cells;
+  CellNotations cellNotations;
 
-  friend Property;
+  friend Arena;
 };
 
-class PropertyValueStringList : public Property {};
+// A list of 32 bit cells of which some reference labels (e.g. "<&gic 0 1>")
+class PropertyValuePHandle : public PropertyValueU32 {
+public:
+  struct Reference {
+    uint32_t cellIndex;
+    // The referenced label, which is part of the value and hence stored in
+    // the value's memory resource instead of being interned
+    std::string_view label;
 
-class PropertyValueU32 : public Property {};
+    bool operator==(const Reference &argOther) const {
+      return (cellIndex == argOther.cellIndex) && (label == argOther.label);
+    }
+  };
 
-class PropertyValueU64 : public Property {};
+  PropertyValuePHandle(const PropertyValuePHandle &argProperty,
+                       const Node *argParentNode);
+
+  bool Compare(const Item *argOtherItem) const override;
+  std::string GetEncodedValue() const override;
+  uint64_t GetHash() const override;
+  const std::pmr::vector<Reference> &GetReferences() const noexcept {
+    return references;
+  }
+  ValueType GetValueType() const noexcept override {
+    return ValueType::PHANDLE;
+  }
+  void AppendValueStringRep(std::string &argOutput) const override;
+  void Merge(const Item *argOtherItem, bool argAddFromOther,
+             bool argPurgeItemsNotInOther) override;
+
+private:
+  PropertyValuePHandle(NamePool::NameId argNameId, const Node *argParentNode,
+                       std::string_view argBlobValue,
+                       const std::vector<CellReference> &argReferences,
+                       std::string_view argCellNotations = {});
+
+  std::pmr::vector<Reference> references;
+
+  friend Arena;
+};
 
-class PropertyValuePHandle : public PropertyValueU32 {};
+#endif // PROPERTY_H
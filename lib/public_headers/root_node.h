@@ -21,21 +21,65 @@
  * SOFTWARE.
  */
 
-#include "node.h"
-
 #ifndef ROOT_NODE_H
 #define ROOT_NODE_H
 
+#include "arena.h"
+#include "node.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+class PathIndex;
+
 class RootNode : public Node {
 public:
-  RootNode(const std::string &argLine, std::istringstream &argInStream);
+  RootNode(std::string_view argLine, LineReader &argLineReader);
+  ~RootNode() override;
 
   bool Compare(const Item *argOtherItem) const override;
+  // Return the node with the given device path (e.g. "/soc/serial@12340000")
+  // or nullptr. The path index used for this is built on the first call and
+  // rebuilt after the tree has been modified. Once built, lookups do not lock.
+  const Node *Find(std::string_view argPath) const;
   void Merge(const Item *argOtherItem, bool argAddFromOther,
              bool argPurgeItemsNotInOther) override;
 
 protected:
-  std::string GetStringRep() const override;
+  void Serialize(OutputSink &argOutputSink) const override;
+
+private:
+  RootNode(std::shared_ptr<Arena> argArena);
+  RootNode(std::string_view argLine, std::shared_ptr<Arena> argArena);
+  RootNode(std::string_view argLine, LineReader &argLineReader,
+           std::shared_ptr<Arena> argArena);
+
+  // Take over the ownership of an arena holding items of this tree
+  void AdoptArena(std::shared_ptr<Arena> argArena);
+  // Share the ownership of all arenas of another tree, whose items are shared
+  // by this tree
+  void AdoptArenasOf(const RootNode &argRootNode);
+  // Drop the path index, which must be done before modifying the tree
+  void InvalidatePathIndex();
+
+  // All arenas holding items of this tree, the first being the root node's
+  std::vector<std::shared_ptr<Arena>> arenas;
+  // Published once complete, so that readers need no lock. The mutex only
+  // serializes building and dropping it.
+  mutable std::atomic<PathIndex *> pathIndex{nullptr};
+  mutable std::mutex pathIndexMutex;
+
+  friend class DeviceTreeParser;
+  friend class DtbParser;
+  friend class JsonParser;
+  friend class OverlayApplier;
+  friend class ParseCache;
+  friend class PatchApplier;
+  friend class ThreeWayMerge;
+  friend class WatchedTree;
 };
 
 #endif // ROOT_NODE_H
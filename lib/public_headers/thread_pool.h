@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class TaskGroup;
+
+// Work-stealing thread pool. Every worker has a queue of its own, to which the
+// tasks submitted by it are added and from which it takes the newest task.
+// Idle workers steal the oldest tasks from the queues of the others.
+class ThreadPool {
+public:
+  using Task = std::function<void()>;
+
+  explicit ThreadPool(
+      unsigned argThreadQty = std::thread::hardware_concurrency());
+  ThreadPool(const ThreadPool &argThreadPool) = delete;
+  ~ThreadPool();
+
+  ThreadPool &operator=(const ThreadPool &argThreadPool) = delete;
+
+  unsigned GetThreadQty() const noexcept {
+    return static_cast<unsigned>(threads.size());
+  }
+  // Wake up the threads blocked in RunTasksUntil, which must be done after
+  // the counter they are waiting for dropped to zero
+  void NotifyTasksDone();
+  // Run a queued task of the given group on the calling thread, return false
+  // if there was none
+  bool RunPendingTask(const TaskGroup *argTaskGroup);
+  // Run queued tasks of the given group on the calling thread until the
+  // counter dropped to zero, blocking while none of them is queued. Tasks of
+  // other groups are left to the workers, so that they neither delay the
+  // waiting thread nor nest on its stack.
+  void RunTasksUntil(const std::atomic<std::size_t> &argPendingTaskQty,
+                     const TaskGroup *argTaskGroup);
+  // Queue a task, optionally belonging to a group, which only the threads
+  // waiting for that group help to run
+  void Submit(Task argTask, const TaskGroup *argTaskGroup = nullptr);
+
+private:
+  struct QueuedTask {
+    Task task;
+    const TaskGroup *taskGroup;
+  };
+  struct WorkQueue {
+    std::mutex mutex;
+    std::deque<QueuedTask> tasks;
+  };
+
+  // Return whether a task of the given group is queued
+  bool HasQueuedTask(const TaskGroup *argTaskGroup);
+  // Take a task of the given group or of any group if it is nullptr
+  bool PopTask(std::size_t argQueueIndex, Task &argTask,
+               const TaskGroup *argTaskGroup = nullptr);
+  void RunWorker(std::size_t argQueueIndex);
+
+  std::vector<std::unique_ptr<WorkQueue>> queues;
+  std::vector<std::thread> threads;
+  std::atomic<std::size_t> nextQueueIndex{0};
+  // Number of queued tasks, which is only increased while holding sleepMutex
+  std::atomic<std::ptrdiff_t> queuedTaskQty{0};
+  std::mutex sleepMutex;
+  std::condition_variable wakeUp;
+  // Number of threads blocked in RunTasksUntil, which all have to be woken up
+  // on new tasks, as only some of them may run them
+  std::size_t waitingThreadQty = 0;
+  bool stopping = false;
+};
+
+// Group of tasks which can be waited for. Tasks may add further tasks to the
+// group they are running in.
+class TaskGroup {
+public:
+  explicit TaskGroup(ThreadPool &argThreadPool) : threadPool{argThreadPool} {}
+  TaskGroup(const TaskGroup &argTaskGroup) = delete;
+  ~TaskGroup();
+
+  TaskGroup &operator=(const TaskGroup &argTaskGroup) = delete;
+
+  template <typename Function> void Run(Function &&argFunction) {
+    ++pendingTaskQty;
+    // The group may be gone as soon as its last task finished, so the pool is
+    // not referred to through it
+    threadPool.Submit(
+        [this, pool = &threadPool,
+         function = std::forward<Function>(argFunction)]() mutable {
+          try {
+            function();
+          } catch (...) {
+            std::lock_guard<std::mutex> lock{errorMutex};
+            if (!error) {
+              error = std::current_exception();
+            }
+          }
+          if (--pendingTaskQty == 0) {
+            pool->NotifyTasksDone();
+          }
+        },
+        this);
+  }
+  // Wait for all tasks of the group while helping to run its queued tasks and
+  // rethrow the first exception thrown by any of them
+  void Wait();
+
+private:
+  ThreadPool &threadPool;
+  std::atomic<std::size_t> pendingTaskQty{0};
+  std::mutex errorMutex;
+  std::exception_ptr error;
+};
+
+#endif // THREAD_POOL_H
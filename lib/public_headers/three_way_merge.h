@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef THREE_WAY_MERGE_H
+#define THREE_WAY_MERGE_H
+
+#include <string>
+#include <vector>
+
+class Item;
+class Node;
+class RootNode;
+
+// An item which both sides changed differently relative to the base
+struct MergeConflict {
+  // Return the conflict as JSON object on a single line
+  std::string GetJsonLine() const;
+
+  // Device path of the conflicting node or of the node holding the property
+  std::string path;
+  // The conflicting item of each tree, nullptr if absent
+  const Item *baseItem;
+  const Item *ourItem;
+  const Item *theirItem;
+};
+
+// Applies the changes between a base tree and their tree to our tree, which
+// has been derived from the same base. Changes made by only one side are taken
+// over and equal changes of both sides are accepted. Nodes changed by both
+// sides are merged recursively, while any other item changed differently by
+// both sides is a conflict, for which our item is kept. The trees are walked
+// simultaneously once, finding the counterparts of items by the sorted child
+// indices and skipping subtrees with equal hashes.
+class ThreeWayMerge {
+public:
+  // Return the conflicts in the order of our tree followed by items only in
+  // their tree
+  std::vector<MergeConflict> Merge(RootNode &argOurRootNode,
+                                   const RootNode &argBaseRootNode,
+                                   const RootNode &argTheirRootNode);
+
+private:
+  void MergeNodes(Node &argOurNode, const Node *argBaseNode,
+                  const Node &argTheirNode, std::string &argPath);
+
+  std::vector<MergeConflict> conflicts;
+};
+
+#endif // THREE_WAY_MERGE_H
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef WATCH_SESSION_H
+#define WATCH_SESSION_H
+
+#include "diff_engine.h"
+#include "watched_tree.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class Node;
+
+// Keeps two device tree source files parsed and their differences up to date
+// while they are edited. After a file's changes have been parsed, only the
+// subtree enclosing them is diffed again, as the hashes of all other subtrees
+// are still valid.
+class WatchSession {
+public:
+  WatchSession(const std::string &argFilePath1,
+               const std::string &argFilePath2,
+               bool argParseInParallel = false);
+  ~WatchSession();
+
+  const std::vector<Difference> &GetDifferences() const noexcept {
+    return differences;
+  }
+  // Return the device path of the subtree diffed again on the last update
+  const std::string &GetDiffedPath() const noexcept { return diffedPath; }
+  // Return the tree of the first (0) or the second (1) file
+  const WatchedTree &GetTree(std::size_t argFileIndex) const noexcept {
+    return (argFileIndex == 0) ? tree1 : tree2;
+  }
+  // Parse both files and diff them completely. Return false if either of them
+  // cannot be read or holds no tree.
+  bool Start();
+  // Parse the changes of the first (0) or the second (1) file and update the
+  // differences affected by them. Return false if the file cannot be read or
+  // holds no tree.
+  bool Update(std::size_t argFileIndex);
+
+private:
+  void DiffAll();
+  // Diff the deepest nodes of both trees at the path of the changed node again
+  // and replace the differences below it
+  void DiffChangedNode(const Node &argChangedNode);
+  // Return the position of the differing item in the first tree, which orders
+  // the differences like DiffEngine reports them. Items only in the second
+  // tree are placed behind all items of their parent node.
+  std::vector<std::size_t>
+  GetDifferencePosition(const Difference &argDifference) const;
+  // Return the positions of the node and its ancestors within the items of
+  // their parent nodes, starting below the root node
+  static std::vector<std::size_t> GetNodePosition(const Node &argNode);
+
+  WatchedTree tree1;
+  WatchedTree tree2;
+  std::vector<Difference> differences;
+  std::string diffedPath;
+};
+
+#endif // WATCH_SESSION_H
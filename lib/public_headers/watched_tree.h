@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef WATCHED_TREE_H
+#define WATCHED_TREE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class Node;
+class RootNode;
+
+// A device tree source file which is kept in memory together with its tree
+// and the byte ranges of all of its nodes. On an update only the innermost
+// node enclosing the changed bytes is parsed again and swapped into the tree,
+// after which only the hashes of its ancestors need to be updated. The whole
+// file is parsed again if the change cannot be confined to a single node.
+class WatchedTree {
+public:
+  WatchedTree(const std::string &argFilePath, bool argParseInParallel = false);
+  WatchedTree(const WatchedTree &argWatchedTree) = delete;
+  ~WatchedTree();
+
+  WatchedTree &operator=(const WatchedTree &argWatchedTree) = delete;
+
+  const std::string &GetFilePath() const noexcept { return filePath; }
+  // Return the node parsed again by the last update, which is the root node
+  // after parsing the whole file and nullptr if the file's content did not
+  // change
+  const Node *GetReparsedNode() const noexcept { return reparsedNode; }
+  const RootNode *GetRootNode() const noexcept { return rootNode.get(); }
+  // Return whether the file has been modified since it was read last
+  bool IsModified() const;
+  // Read the file and parse what changed since it was read last. Return false
+  // if the file cannot be read or holds no tree. The tree is left untouched if
+  // parsing throws, so that the next update is compared to the last valid
+  // content again.
+  bool Update();
+
+private:
+  static constexpr std::size_t NO_PARENT = SIZE_MAX;
+
+  struct NodeRange {
+    Node *node;
+    // Index of the range of the parent node
+    std::size_t parentIndex;
+    // Offsets of the node's start line, its end line and past its end line
+    std::string::size_type begin;
+    std::string::size_type endLineBegin;
+    std::string::size_type end;
+  };
+
+  // Parse the node enclosing the changes of the new buffer, which starts with
+  // the given number of unchanged bytes, and swap it into the tree. Return
+  // false if the changes cannot be confined to a single node.
+  bool ParseChangedNode(std::string_view argNewBuffer,
+                        std::string_view::size_type argPrefixSize);
+  bool ParseFile(std::string_view argNewBuffer);
+  // Scan the buffer for the ranges of all nodes in source order by matching
+  // node start and end lines like Node::Node does. The parent indices are
+  // relative to the scanned ranges. Return false if the nodes are unbalanced.
+  static bool ScanNodeRanges(std::string_view argBuffer,
+                             std::vector<NodeRange> &argNodeRanges);
+
+  const std::string filePath;
+  const bool parseInParallel = false;
+  // The file's content as parsed last and the buffer the next one is read to
+  std::string buffer;
+  std::string nextBuffer;
+  std::unique_ptr<RootNode> rootNode;
+  // The ranges of all nodes in source order, which is the tree's pre-order.
+  // Empty if they do not match the tree, in which case every update parses
+  // the whole file.
+  std::vector<NodeRange> nodeRanges;
+  const Node *reparsedNode = nullptr;
+  // Size of the sources parsed again into the tree's arena since the file has
+  // been parsed as a whole, which holds the replaced nodes until then
+  std::string::size_type reparsedSize = 0;
+  // Modification time and size of the file when it was read last
+  int64_t modificationTime = -1;
+  int64_t fileSize = -1;
+};
+
+#endif // WATCHED_TREE_H
@@ -22,9 +22,65 @@
  */
 
 #include "root_node.h"
+#include "output_sink.h"
+#include "path_index.h"
+#include "string_utils.h"
 
-RootNode::RootNode(const std::string &argLine, std::istringstream &argInStream)
-    : Node{argLine, argInStream, nullptr} {}
+#include <algorithm>
+#include <stdexcept>
+
+RootNode::RootNode(std::string_view argLine, LineReader &argLineReader)
+    : RootNode{argLine, argLineReader, std::make_shared<Arena>()} {}
+
+// The arena is passed in by the delegating constructors, because it has to
+// exist before the Node base is constructed
+RootNode::RootNode(std::shared_ptr<Arena> argArena)
+    : Node{"/", {}, nullptr, *argArena}, arenas{std::move(argArena)} {}
+
+RootNode::RootNode(std::string_view argLine, std::shared_ptr<Arena> argArena)
+    : Node{ExtractNodeName(argLine).nodeName,
+           ExtractNodeName(argLine).unitAddress, nullptr, *argArena},
+      arenas{std::move(argArena)} {}
+
+RootNode::RootNode(std::string_view argLine, LineReader &argLineReader,
+                   std::shared_ptr<Arena> argArena)
+    : Node{argLine, argLineReader, nullptr, *argArena},
+      arenas{std::move(argArena)} {}
+
+RootNode::~RootNode() { delete pathIndex.load(); }
+
+void RootNode::AdoptArena(std::shared_ptr<Arena> argArena) {
+  arenas.emplace_back(std::move(argArena));
+}
+
+void RootNode::AdoptArenasOf(const RootNode &argRootNode) {
+  for (const auto &arena : argRootNode.arenas) {
+    if (std::find(std::begin(arenas), std::end(arenas), arena) ==
+        std::end(arenas)) {
+      arenas.emplace_back(arena);
+    }
+  }
+}
+
+const Node *RootNode::Find(const std::string_view argPath) const {
+  auto index = pathIndex.load(std::memory_order_acquire);
+  if (index == nullptr) {
+    // Only the first caller builds the index, concurrent ones wait for it
+    std::lock_guard<std::mutex> lock{pathIndexMutex};
+    index = pathIndex.load(std::memory_order_relaxed);
+    if (index == nullptr) {
+      index = new PathIndex{*this};
+      pathIndex.store(index, std::memory_order_release);
+    }
+  }
+  return index->Find(argPath);
+}
+
+void RootNode::InvalidatePathIndex() {
+  // The tree is modified afterwards, so there must not be concurrent lookups
+  std::lock_guard<std::mutex> lock{pathIndexMutex};
+  delete pathIndex.exchange(nullptr, std::memory_order_relaxed);
+}
 
 bool RootNode::Compare(const Item *argOtherItem) const {
   if (dynamic_cast<const RootNode *>(argOtherItem) == nullptr) {
@@ -34,15 +90,20 @@ bool RootNode::Compare(const Item *argOtherItem) const {
   return Node::Compare(argOtherItem);
 }
 
-std::string RootNode::GetStringRep() const {
-  return "/dts-v1/;\n\n" + Node::GetStringRep();
+void RootNode::Serialize(OutputSink &argOutputSink) const {
+  argOutputSink.Append("/dts-v1/;\n\n");
+  Node::Serialize(argOutputSink);
 }
 
 void RootNode::Merge(const Item *argOtherItem, bool argAddFromOther,
                      bool argPurgeItemsNotInOther) {
-  if (dynamic_cast<const RootNode *>(argOtherItem) == nullptr) {
+  const auto otherRootNode = dynamic_cast<const RootNode *>(argOtherItem);
+  if (otherRootNode == nullptr) {
     throw std::invalid_argument{"Try to merge unrelated class into RootNode"};
   }
 
+  InvalidatePathIndex();
   Node::Merge(argOtherItem, argAddFromOther, argPurgeItemsNotInOther);
+  // Items of the other tree may be shared by this one now
+  AdoptArenasOf(*otherRootNode);
 }
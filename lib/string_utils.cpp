@@ -28,31 +28,42 @@
 constexpr char SPACE_CHAR = 0x20;
 constexpr char TAB_CHAR = 0x09;
 
-NodeName ExtractNodeName(const std::string &argInputStr) {
-  if (argInputStr.find('{') == std::string::npos) {
+NodeName ExtractNodeName(const std::string_view argInputStr) {
+  if (argInputStr.find('{') == std::string_view::npos) {
     throw std::invalid_argument{"Node line does not contain '{'"};
   }
-  const auto withoutLeadingWhitespaceStr{RemoveLeadingWhitespace(argInputStr)};
-  const auto nextSpaceIdx = withoutLeadingWhitespaceStr.find(0x20);
+  auto withoutLeadingWhitespaceStr{RemoveLeadingWhitespace(argInputStr)};
+  auto nextSpaceIdx = withoutLeadingWhitespaceStr.find(SPACE_CHAR);
+  // A label is separated from the node name by a colon
+  std::string_view label;
+  const auto colonPos = withoutLeadingWhitespaceStr.find(':');
+  if ((colonPos != std::string_view::npos) && (colonPos < nextSpaceIdx)) {
+    label = withoutLeadingWhitespaceStr.substr(0, colonPos);
+    withoutLeadingWhitespaceStr = RemoveLeadingWhitespace(
+        withoutLeadingWhitespaceStr.substr(colonPos + 1));
+    nextSpaceIdx = withoutLeadingWhitespaceStr.find(SPACE_CHAR);
+  }
   const auto nodeName{withoutLeadingWhitespaceStr.substr(0, nextSpaceIdx)};
   const auto atPos = nodeName.find('@');
-  return NodeName{nodeName.substr(0, atPos), nodeName.substr(atPos + 1)};
+  if (atPos == std::string_view::npos) {
+    return NodeName{nodeName, {}, label};
+  }
+  return NodeName{nodeName.substr(0, atPos), nodeName.substr(atPos + 1),
+                  label};
 }
 
-std::string RemoveLeadingWhitespace(const std::string &argInputStr) {
-  std::string::size_type dataStartIdx = 0u;
-  for (auto i = 0u; i < argInputStr.size(); ++i) {
+std::string_view RemoveLeadingWhitespace(const std::string_view argInputStr) {
+  for (std::string_view::size_type i = 0u; i < argInputStr.size(); ++i) {
     if ((argInputStr[i] != SPACE_CHAR) && (argInputStr[i] != TAB_CHAR)) {
-      dataStartIdx = i;
-      break;
+      return argInputStr.substr(i);
     }
   }
-  return argInputStr.substr(dataStartIdx);
+  return {};
 }
 
-std::string RemoveTrailingSemicolon(const std::string &argInputStr) {
+std::string_view RemoveTrailingSemicolon(const std::string_view argInputStr) {
   const auto semicolonPos = argInputStr.find(';');
-  if ((semicolonPos == std::string::npos) ||
+  if ((semicolonPos == std::string_view::npos) ||
       (semicolonPos != argInputStr.size() - 1)) {
     throw std::invalid_argument{"Property string does not end on semicolon"};
   }
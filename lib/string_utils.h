@@ -24,15 +24,17 @@
 #ifndef STRING_UTILS_H
 #define STRING_UTILS_H
 
-#include <string>
+#include <string_view>
 
 struct NodeName {
-  const std::string nodeName;
-  const std::string unitAddress;
+  const std::string_view nodeName;
+  const std::string_view unitAddress;
+  // Label preceding the node name, if any
+  const std::string_view label;
 };
 
-NodeName ExtractNodeName(const std::string &argInputStr);
-std::string RemoveLeadingWhitespace(const std::string &argInputStr);
-std::string RemoveTrailingSemicolon(const std::string &argInputStr);
+NodeName ExtractNodeName(std::string_view argInputStr);
+std::string_view RemoveLeadingWhitespace(std::string_view argInputStr);
+std::string_view RemoveTrailingSemicolon(std::string_view argInputStr);
 
 #endif // STRING_UTILS_H
@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <iterator>
+
+// Queue of the worker running on the current thread, if any
+static thread_local const ThreadPool *currentThreadPool = nullptr;
+static thread_local std::size_t currentQueueIndex = 0;
+
+ThreadPool::ThreadPool(const unsigned argThreadQty) {
+  const auto threadQty = std::max(1u, argThreadQty);
+  for (auto i = 0u; i < threadQty; ++i) {
+    queues.emplace_back(std::make_unique<WorkQueue>());
+  }
+  for (auto i = 0u; i < threadQty; ++i) {
+    threads.emplace_back(&ThreadPool::RunWorker, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock{sleepMutex};
+    stopping = true;
+  }
+  wakeUp.notify_all();
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+bool ThreadPool::HasQueuedTask(const TaskGroup *const argTaskGroup) {
+  for (auto &queue : queues) {
+    std::lock_guard<std::mutex> lock{queue->mutex};
+    if (std::any_of(queue->tasks.begin(), queue->tasks.end(),
+                    [argTaskGroup](const QueuedTask &argQueuedTask) {
+                      return argQueuedTask.taskGroup == argTaskGroup;
+                    })) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ThreadPool::PopTask(const std::size_t argQueueIndex, Task &argTask,
+                         const TaskGroup *const argTaskGroup) {
+  const auto isWanted = [argTaskGroup](const QueuedTask &argQueuedTask) {
+    return (argTaskGroup == nullptr) ||
+           (argQueuedTask.taskGroup == argTaskGroup);
+  };
+
+  // Take the newest task of the own queue first ...
+  {
+    auto &queue = *queues[argQueueIndex];
+    std::lock_guard<std::mutex> lock{queue.mutex};
+    const auto it =
+        std::find_if(queue.tasks.rbegin(), queue.tasks.rend(), isWanted);
+    if (it != queue.tasks.rend()) {
+      argTask = std::move(it->task);
+      queue.tasks.erase(std::next(it).base());
+      --queuedTaskQty;
+      return true;
+    }
+  }
+
+  // ... and otherwise steal the oldest task of another queue
+  for (std::size_t i = 1; i < queues.size(); ++i) {
+    auto &queue = *queues[(argQueueIndex + i) % queues.size()];
+    std::lock_guard<std::mutex> lock{queue.mutex};
+    const auto it =
+        std::find_if(queue.tasks.begin(), queue.tasks.end(), isWanted);
+    if (it != queue.tasks.end()) {
+      argTask = std::move(it->task);
+      queue.tasks.erase(it);
+      --queuedTaskQty;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void ThreadPool::NotifyTasksDone() {
+  // Taking the mutex ensures that no thread is between checking the counter
+  // and starting to wait
+  {
+    std::lock_guard<std::mutex> lock{sleepMutex};
+  }
+  wakeUp.notify_all();
+}
+
+bool ThreadPool::RunPendingTask(const TaskGroup *const argTaskGroup) {
+  const auto queueIndex = currentThreadPool == this
+                              ? currentQueueIndex
+                              : nextQueueIndex++ % queues.size();
+  Task task;
+  if (PopTask(queueIndex, task, argTaskGroup) == false) {
+    return false;
+  }
+  task();
+  return true;
+}
+
+void ThreadPool::RunTasksUntil(
+    const std::atomic<std::size_t> &argPendingTaskQty,
+    const TaskGroup *const argTaskGroup) {
+  while (argPendingTaskQty > 0) {
+    if (RunPendingTask(argTaskGroup)) {
+      continue;
+    }
+
+    // The awaited tasks run on other threads, which may still queue tasks
+    std::unique_lock<std::mutex> lock{sleepMutex};
+    ++waitingThreadQty;
+    wakeUp.wait(lock, [this, &argPendingTaskQty, argTaskGroup]() {
+      return (argPendingTaskQty == 0) || HasQueuedTask(argTaskGroup);
+    });
+    --waitingThreadQty;
+  }
+}
+
+void ThreadPool::RunWorker(const std::size_t argQueueIndex) {
+  currentThreadPool = this;
+  currentQueueIndex = argQueueIndex;
+
+  Task task;
+  while (true) {
+    if (PopTask(argQueueIndex, task)) {
+      task();
+      task = nullptr;
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock{sleepMutex};
+    wakeUp.wait(lock, [this]() { return stopping || (queuedTaskQty > 0); });
+    if (stopping && (queuedTaskQty <= 0)) {
+      return;
+    }
+  }
+}
+
+void ThreadPool::Submit(Task argTask, const TaskGroup *const argTaskGroup) {
+  // Tasks submitted by workers are added to their own queue, others are
+  // distributed among all queues
+  const auto queueIndex = currentThreadPool == this
+                              ? currentQueueIndex
+                              : nextQueueIndex++ % queues.size();
+  {
+    auto &queue = *queues[queueIndex];
+    std::lock_guard<std::mutex> lock{queue.mutex};
+    queue.tasks.push_back({std::move(argTask), argTaskGroup});
+  }
+  // The task is queued before taking the mutex, so that threads starting to
+  // wait afterwards find it and those waiting already are counted. The counter
+  // may drop below zero meanwhile, if the task is taken right away.
+  bool hasWaitingThreads = false;
+  {
+    std::lock_guard<std::mutex> lock{sleepMutex};
+    ++queuedTaskQty;
+    hasWaitingThreads = waitingThreadQty != 0;
+  }
+  if (hasWaitingThreads) {
+    wakeUp.notify_all();
+  } else {
+    wakeUp.notify_one();
+  }
+}
+
+TaskGroup::~TaskGroup() {
+  // Tasks must not outlive the group they refer to
+  threadPool.RunTasksUntil(pendingTaskQty, this);
+}
+
+void TaskGroup::Wait() {
+  threadPool.RunTasksUntil(pendingTaskQty, this);
+
+  std::lock_guard<std::mutex> lock{errorMutex};
+  if (error) {
+    std::rethrow_exception(std::exchange(error, nullptr));
+  }
+}
@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "three_way_merge.h"
+#include "json.h"
+#include "property.h"
+#include "root_node.h"
+
+#include <utility>
+
+// Items are equal if both are absent or if they compare equal, which for nodes
+// is decided by their hashes
+static bool IsEqual(const Item *const argItem1, const Item *const argItem2) {
+  if ((argItem1 == nullptr) || (argItem2 == nullptr)) {
+    return argItem1 == argItem2;
+  }
+  return argItem1->Compare(argItem2);
+}
+
+// Append the name of a child node to the device path of its parent node
+static void AppendChildPath(std::string &argPath, const Item &argChildNode) {
+  if (argPath.size() != 1) {
+    argPath.push_back('/');
+  }
+  argPath.append(argChildNode.GetName());
+}
+
+// Append an item of one of the trees. Absent items are left out, nodes are
+// given as "true" and empty properties as "null".
+static void AppendJsonItem(std::string &argOutput, const char *argKey,
+                           const Item *argItem) {
+  if (argItem == nullptr) {
+    return;
+  }
+  argOutput.append(",\"");
+  argOutput.append(argKey);
+  argOutput.append("\":");
+  if (argItem->GetType() != Item::Type::PROPERTY) {
+    argOutput.append("true");
+    return;
+  }
+  if (dynamic_cast<const PropertyEmpty *>(argItem) != nullptr) {
+    argOutput.append("null");
+    return;
+  }
+  AppendJsonString(argOutput,
+                   static_cast<const Property *>(argItem)->GetValueStringRep());
+}
+
+std::string MergeConflict::GetJsonLine() const {
+  const auto item =
+      ourItem ? ourItem : (theirItem ? theirItem : baseItem);
+
+  std::string resultStr{"{\"type\":\"conflict\",\"path\":"};
+  AppendJsonString(resultStr, path);
+  if (item->GetType() != Item::Type::PROPERTY) {
+    resultStr.append(",\"item\":\"node\"");
+  } else {
+    resultStr.append(",\"item\":\"property\",\"name\":");
+    AppendJsonString(resultStr, item->GetName());
+  }
+  AppendJsonItem(resultStr, "base", baseItem);
+  AppendJsonItem(resultStr, "ours", ourItem);
+  AppendJsonItem(resultStr, "theirs", theirItem);
+  resultStr.push_back('}');
+  return resultStr;
+}
+
+std::vector<MergeConflict>
+ThreeWayMerge::Merge(RootNode &argOurRootNode, const RootNode &argBaseRootNode,
+                     const RootNode &argTheirRootNode) {
+  conflicts.clear();
+  argOurRootNode.InvalidatePathIndex();
+  std::string path{"/"};
+  MergeNodes(argOurRootNode, &argBaseRootNode, argTheirRootNode, path);
+  argOurRootNode.AdoptArenasOf(argTheirRootNode);
+  return std::move(conflicts);
+}
+
+void ThreeWayMerge::MergeNodes(Node &argOurNode, const Node *const argBaseNode,
+                               const Node &argTheirNode,
+                               std::string &argPath) {
+  // Counterparts are matched by name, unit address and kind, so that a node
+  // and a property of the same name are never taken for one another
+  const auto findItem = [](const Node *argNode,
+                           const Item &argItem) -> const Item * {
+    if (argNode == nullptr) {
+      return nullptr;
+    }
+    return argNode->FindItem(argItem.GetNameId(), argItem.GetUnitAddressId(),
+                             argItem.GetType() == Item::Type::PROPERTY);
+  };
+  // Paths are passed down instead of being derived from the items, whose
+  // parents are in another tree if they are shared
+  const auto addConflict = [this, &argPath](const Item *argBaseItem,
+                                            const Item *argOurItem,
+                                            const Item *argTheirItem) {
+    const auto item = argOurItem ? argOurItem : argTheirItem;
+    std::string path{argPath};
+    if (item->GetType() != Item::Type::PROPERTY) {
+      AppendChildPath(path, *item);
+    }
+    conflicts.push_back(
+        {std::move(path), argBaseItem, argOurItem, argTheirItem});
+  };
+
+  // Our items, which are only touched if their side changed them
+  const auto itemQty = argOurNode.items.size();
+  for (auto it = argOurNode.items.begin(); it != argOurNode.items.end();) {
+    const auto baseItem = findItem(argBaseNode, **it);
+    const auto theirItem = findItem(&argTheirNode, **it);
+    if (IsEqual(theirItem, baseItem) || IsEqual(*it, theirItem)) {
+      ++it;
+      continue;
+    }
+
+    if (IsEqual(*it, baseItem)) {
+      if (theirItem == nullptr) {
+        it = argOurNode.items.erase(it);
+        continue;
+      }
+      *it = argOurNode.ShareItem(theirItem);
+    } else if ((theirItem != nullptr) &&
+               ((*it)->GetType() == Item::Type::NODE)) {
+      if ((*it)->IsShared()) {
+        *it = argOurNode.UnshareItem(*it);
+      }
+      const auto pathSize = argPath.size();
+      AppendChildPath(argPath, **it);
+      MergeNodes(*static_cast<Node *>(*it),
+                 static_cast<const Node *>(baseItem),
+                 *static_cast<const Node *>(theirItem), argPath);
+      argPath.resize(pathSize);
+    } else {
+      addConflict(baseItem, *it, theirItem);
+    }
+    ++it;
+  }
+  if (argOurNode.items.size() != itemQty) {
+    argOurNode.BuildChildIndex();
+  }
+
+  // Their items missing in our node, which were either added by them or
+  // removed by us. Of multiple items with the same name only the first one is
+  // considered, like for the items of our node.
+  const auto mergedItemQty = argOurNode.items.size();
+  for (const auto theirItem : argTheirNode.items) {
+    if ((findItem(&argOurNode, *theirItem) != nullptr) ||
+        (findItem(&argTheirNode, *theirItem) != theirItem)) {
+      continue;
+    }
+
+    const auto baseItem = findItem(argBaseNode, *theirItem);
+    if (baseItem == nullptr) {
+      argOurNode.items.emplace_back(argOurNode.ShareItem(theirItem));
+    } else if (IsEqual(theirItem, baseItem) == false) {
+      addConflict(baseItem, nullptr, theirItem);
+    }
+  }
+  if (argOurNode.items.size() != mergedItemQty) {
+    argOurNode.BuildChildIndex();
+  }
+
+  argOurNode.UpdateHash();
+}
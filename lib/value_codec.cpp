@@ -0,0 +1,486 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "value_codec.h"
+#include "fdt.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <exception>
+#include <system_error>
+#include <utility>
+
+class InvalidPropertyValueException : public std::exception {
+  const char *what() const noexcept override;
+};
+
+const char *InvalidPropertyValueException::what() const noexcept {
+  return "Encountered invalid or unsupported property value on encoding";
+}
+
+constexpr auto HEX_DIGITS = "0123456789abcdef";
+
+constexpr uint8_t CELL_NOTATION_HEXADECIMAL = 0;
+constexpr uint8_t CELL_NOTATION_DECIMAL = 1;
+constexpr uint8_t CELL_NOTATION_OCTAL = 2;
+constexpr uint8_t CELL_NOTATION_RADIX_MASK = 0x3;
+constexpr uint8_t CELL_NOTATION_UPPER_CASE = 0x4;
+constexpr unsigned CELL_NOTATION_DIGIT_SHIFT = 3;
+constexpr std::size_t MAXIMUM_CELL_NOTATION_DIGITS = 0xff >> 3;
+
+void AppendCell(std::string &argOutput, const uint64_t argCell,
+                const uint8_t argNotation) {
+  auto base = 16;
+  switch (argNotation & CELL_NOTATION_RADIX_MASK) {
+  case CELL_NOTATION_DECIMAL:
+    base = 10;
+    break;
+  case CELL_NOTATION_OCTAL:
+    base = 8;
+    argOutput.push_back('0');
+    break;
+  default:
+    argOutput.append("0x");
+    break;
+  }
+
+  // Sufficient for the 22 octal digits of a 64 bit cell
+  char digits[24];
+  const auto digitsEnd =
+      std::to_chars(digits, digits + sizeof(digits), argCell, base).ptr;
+  const auto digitQty = static_cast<std::size_t>(digitsEnd - digits);
+  const std::size_t paddedDigitQty = argNotation >> CELL_NOTATION_DIGIT_SHIFT;
+  if (digitQty < paddedDigitQty) {
+    argOutput.append(paddedDigitQty - digitQty, '0');
+  }
+  if ((argNotation & CELL_NOTATION_UPPER_CASE) != 0) {
+    std::transform(digits, digitsEnd, digits,
+                   [](const char c) { return std::toupper(c); });
+  }
+  argOutput.append(digits, digitsEnd);
+}
+
+void AppendHexNumber(std::string &argOutput, const uint64_t argNumber) {
+  argOutput.append("0x");
+  auto shift = 60;
+  // Omit leading zeroes like dtc does
+  while ((shift > 0) && (((argNumber >> shift) & 0xf) == 0)) {
+    shift -= 4;
+  }
+  for (; shift >= 0; shift -= 4) {
+    argOutput.push_back(HEX_DIGITS[(argNumber >> shift) & 0xf]);
+  }
+}
+
+void AppendQuotedStrings(std::string &argOutput,
+                         const std::string_view argStrings) {
+  argOutput.push_back('"');
+  for (std::string_view::size_type i = 0; i + 1 < argStrings.size(); ++i) {
+    const auto c = static_cast<unsigned char>(argStrings[i]);
+    switch (c) {
+    case '\0':
+      argOutput.append("\", \"");
+      break;
+    case '"':
+    case '\\':
+      argOutput.push_back('\\');
+      argOutput.push_back(static_cast<char>(c));
+      break;
+    case '\n':
+      argOutput.append("\\n");
+      break;
+    case '\r':
+      argOutput.append("\\r");
+      break;
+    case '\t':
+      argOutput.append("\\t");
+      break;
+    default:
+      if ((c < 0x20) || (c > 0x7e)) {
+        argOutput.append("\\x");
+        argOutput.push_back(HEX_DIGITS[c >> 4]);
+        argOutput.push_back(HEX_DIGITS[c & 0xf]);
+        break;
+      }
+      argOutput.push_back(static_cast<char>(c));
+      break;
+    }
+  }
+  argOutput.push_back('"');
+}
+
+bool IsPrintableStringList(const std::string_view argValue) {
+  // Like dtc require a terminating null character and no empty strings
+  if ((argValue.empty() == true) || (argValue.front() == '\0') ||
+      (argValue.back() != '\0')) {
+    return false;
+  }
+  for (std::string_view::size_type i = 0; i < argValue.size(); ++i) {
+    const auto c = static_cast<unsigned char>(argValue[i]);
+    if (c == '\0') {
+      if ((i > 0) && (argValue[i - 1] == '\0')) {
+        return false;
+      }
+      continue;
+    }
+    if ((c < 0x20) || (c > 0x7e)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::string DecodeValue(const std::string_view argValue) {
+  std::string resultStr;
+  if (IsPrintableStringList(argValue)) {
+    AppendQuotedStrings(resultStr, argValue);
+    return resultStr;
+  }
+
+  if (argValue.size() % sizeof(uint32_t) == 0) {
+    resultStr.push_back('<');
+    for (std::string_view::size_type i = 0; i < argValue.size();
+         i += sizeof(uint32_t)) {
+      if (i != 0) {
+        resultStr.push_back(' ');
+      }
+      AppendHexNumber(resultStr, ReadBigEndianU32(argValue.data() + i));
+    }
+    resultStr.push_back('>');
+    return resultStr;
+  }
+
+  resultStr.push_back('[');
+  for (std::string_view::size_type i = 0; i < argValue.size(); ++i) {
+    if (i != 0) {
+      resultStr.push_back(' ');
+    }
+    const auto byte = static_cast<unsigned char>(argValue[i]);
+    resultStr.push_back(HEX_DIGITS[byte >> 4]);
+    resultStr.push_back(HEX_DIGITS[byte & 0xf]);
+  }
+  resultStr.push_back(']');
+  return resultStr;
+}
+
+static std::string_view SkipWhitespace(const std::string_view argInput) {
+  const auto dataStart = argInput.find_first_not_of(" \t\r\n");
+  return dataStart == std::string_view::npos ? std::string_view{}
+                                             : argInput.substr(dataStart);
+}
+
+static void AppendBigEndian(std::string &argOutput, const uint64_t argValue,
+                            const unsigned argBits) {
+  for (auto shift = static_cast<int>(argBits) - 8; shift >= 0; shift -= 8) {
+    argOutput.push_back(static_cast<char>((argValue >> shift) & 0xff));
+  }
+}
+
+static bool IsHexDigit(const char argChar) {
+  return ((argChar >= '0') && (argChar <= '9')) ||
+         ((argChar >= 'a') && (argChar <= 'f')) ||
+         ((argChar >= 'A') && (argChar <= 'F'));
+}
+
+static unsigned ParseHexDigit(const char argChar) {
+  if ((argChar >= '0') && (argChar <= '9')) {
+    return static_cast<unsigned>(argChar - '0');
+  }
+  if ((argChar >= 'a') && (argChar <= 'f')) {
+    return static_cast<unsigned>(argChar - 'a' + 10);
+  }
+  if ((argChar >= 'A') && (argChar <= 'F')) {
+    return static_cast<unsigned>(argChar - 'A' + 10);
+  }
+  throw InvalidPropertyValueException{};
+}
+
+// Encode a quoted string including its terminating null character and return
+// the remaining input
+static std::string_view EncodeString(std::string_view argInput,
+                                     std::string &argOutput) {
+  argInput.remove_prefix(1);
+  while ((argInput.empty() == false) && (argInput.front() != '"')) {
+    if (argInput.front() != '\\') {
+      argOutput.push_back(argInput.front());
+      argInput.remove_prefix(1);
+      continue;
+    }
+    if (argInput.size() < 2) {
+      throw InvalidPropertyValueException{};
+    }
+    const auto escapedChar = argInput[1];
+    argInput.remove_prefix(2);
+    switch (escapedChar) {
+    case 'a':
+      argOutput.push_back('\a');
+      break;
+    case 'b':
+      argOutput.push_back('\b');
+      break;
+    case 'f':
+      argOutput.push_back('\f');
+      break;
+    case 'n':
+      argOutput.push_back('\n');
+      break;
+    case 'r':
+      argOutput.push_back('\r');
+      break;
+    case 't':
+      argOutput.push_back('\t');
+      break;
+    case 'v':
+      argOutput.push_back('\v');
+      break;
+    // Like dtc accept one or two hexadecimal and up to three octal digits
+    case 'x': {
+      if ((argInput.empty() == true) || (IsHexDigit(argInput[0]) == false)) {
+        throw InvalidPropertyValueException{};
+      }
+      auto byte = ParseHexDigit(argInput[0]);
+      argInput.remove_prefix(1);
+      if ((argInput.empty() == false) && IsHexDigit(argInput[0])) {
+        byte = (byte << 4) | ParseHexDigit(argInput[0]);
+        argInput.remove_prefix(1);
+      }
+      argOutput.push_back(static_cast<char>(byte));
+      break;
+    }
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7': {
+      auto byte = static_cast<unsigned>(escapedChar - '0');
+      for (auto i = 0; (i < 2) && (argInput.empty() == false) &&
+                       (argInput[0] >= '0') && (argInput[0] <= '7');
+           ++i) {
+        byte = (byte << 3) | static_cast<unsigned>(argInput[0] - '0');
+        argInput.remove_prefix(1);
+      }
+      if (byte > 0xff) {
+        throw InvalidPropertyValueException{};
+      }
+      argOutput.push_back(static_cast<char>(byte));
+      break;
+    }
+    default:
+      argOutput.push_back(escapedChar);
+      break;
+    }
+  }
+  if (argInput.empty()) {
+    throw InvalidPropertyValueException{};
+  }
+  argOutput.push_back('\0');
+  return argInput.substr(1);
+}
+
+// Encode a list of cells of the given bit width and return the remaining input
+static std::string_view
+EncodeCells(std::string_view argInput, EncodedValue &argEncodedValue,
+            const unsigned argBits) {
+  auto &output = argEncodedValue.data;
+  argInput = SkipWhitespace(argInput.substr(1));
+  while ((argInput.empty() == false) && (argInput.front() != '>')) {
+    const auto literalEnd = argInput.find_first_of(" \t\r\n>");
+    if (literalEnd == std::string_view::npos) {
+      throw InvalidPropertyValueException{};
+    }
+
+    // References to labels are recorded and encoded as zero for now
+    if (argInput.front() == '&') {
+      if ((argBits != 32) || (literalEnd < 2)) {
+        throw InvalidPropertyValueException{};
+      }
+      argEncodedValue.references.push_back(
+          {static_cast<uint32_t>(output.size() / sizeof(uint32_t)),
+           argInput.substr(1, literalEnd - 1)});
+      AppendBigEndian(output, 0, argBits);
+      argEncodedValue.cellNotations.push_back(
+          static_cast<char>(DTC_CELL_NOTATION));
+      argInput = SkipWhitespace(argInput.substr(literalEnd));
+      continue;
+    }
+
+    // Besides references only plain integer literals are supported (no
+    // character literals or expressions)
+    auto literal = argInput.substr(0, literalEnd);
+    auto base = 10;
+    uint8_t notation = CELL_NOTATION_DECIMAL;
+    if ((literal.size() > 2) && (literal[0] == '0') &&
+        ((literal[1] == 'x') || (literal[1] == 'X'))) {
+      base = 16;
+      notation = CELL_NOTATION_HEXADECIMAL;
+      literal.remove_prefix(2);
+      if (std::any_of(literal.begin(), literal.end(), [](const char c) {
+            return (c >= 'A') && (c <= 'F');
+          })) {
+        notation |= CELL_NOTATION_UPPER_CASE;
+      }
+    } else if ((literal.size() > 1) && (literal[0] == '0')) {
+      base = 8;
+      notation = CELL_NOTATION_OCTAL;
+      literal.remove_prefix(1);
+    }
+    uint64_t cell = 0;
+    const auto parseResult = std::from_chars(
+        literal.data(), literal.data() + literal.size(), cell, base);
+    if ((parseResult.ec != std::errc{}) ||
+        (parseResult.ptr != literal.data() + literal.size()) ||
+        ((argBits < 64) && (cell >> argBits != 0))) {
+      throw InvalidPropertyValueException{};
+    }
+    AppendBigEndian(output, cell, argBits);
+    // Keep leading zeroes of the literal to print it as it was given
+    notation |= static_cast<uint8_t>(
+        std::min(literal.size(), MAXIMUM_CELL_NOTATION_DIGITS)
+        << CELL_NOTATION_DIGIT_SHIFT);
+    argEncodedValue.cellNotations.push_back(static_cast<char>(notation));
+    argInput = SkipWhitespace(argInput.substr(literalEnd));
+  }
+  if (argInput.empty()) {
+    throw InvalidPropertyValueException{};
+  }
+  return argInput.substr(1);
+}
+
+// Encode a byte string and return the remaining input
+static std::string_view EncodeBytes(std::string_view argInput,
+                                    std::string &argOutput) {
+  argInput = SkipWhitespace(argInput.substr(1));
+  while ((argInput.empty() == false) && (argInput.front() != ']')) {
+    if (argInput.size() < 2) {
+      throw InvalidPropertyValueException{};
+    }
+    const auto byte = (ParseHexDigit(argInput[0]) << 4) |
+                      ParseHexDigit(argInput[1]);
+    argOutput.push_back(static_cast<char>(byte));
+    argInput = SkipWhitespace(argInput.substr(2));
+  }
+  if (argInput.empty()) {
+    throw InvalidPropertyValueException{};
+  }
+  return argInput.substr(1);
+}
+
+static void EncodeComponents(const std::string_view argValue,
+                             EncodedValue &argEncodedValue) {
+  constexpr std::string_view BITS_DIRECTIVE = "/bits/";
+
+  bool onlyStrings = true;
+  bool onlyCells32 = true;
+  bool onlyCells64 = true;
+  auto remainder = SkipWhitespace(argValue);
+  while (true) {
+    unsigned bits = 32;
+    if (remainder.substr(0, BITS_DIRECTIVE.size()) == BITS_DIRECTIVE) {
+      remainder = SkipWhitespace(remainder.substr(BITS_DIRECTIVE.size()));
+      const auto widthEnd = remainder.find_first_not_of("0123456789");
+      const auto width = remainder.substr(0, widthEnd);
+      if (width == "8") {
+        bits = 8;
+      } else if (width == "16") {
+        bits = 16;
+      } else if (width == "64") {
+        bits = 64;
+      } else if (width != "32") {
+        throw InvalidPropertyValueException{};
+      }
+      remainder = SkipWhitespace(remainder.substr(width.size()));
+      if ((remainder.empty() == true) || (remainder.front() != '<')) {
+        throw InvalidPropertyValueException{};
+      }
+    }
+
+    if (remainder.empty() == true) {
+      throw InvalidPropertyValueException{};
+    }
+    switch (remainder.front()) {
+    case '"':
+      onlyCells32 = false;
+      onlyCells64 = false;
+      remainder = EncodeString(remainder, argEncodedValue.data);
+      break;
+    case '<':
+      onlyStrings = false;
+      onlyCells32 = onlyCells32 && (bits == 32);
+      onlyCells64 = onlyCells64 && (bits == 64);
+      remainder = EncodeCells(remainder, argEncodedValue, bits);
+      break;
+    case '[':
+      onlyStrings = false;
+      onlyCells32 = false;
+      onlyCells64 = false;
+      remainder = EncodeBytes(remainder, argEncodedValue.data);
+      break;
+    default:
+      throw InvalidPropertyValueException{};
+    }
+
+    // Components of a value are separated by commas
+    remainder = SkipWhitespace(remainder);
+    if (remainder.empty() == true) {
+      break;
+    }
+    if (remainder.front() != ',') {
+      throw InvalidPropertyValueException{};
+    }
+    remainder = SkipWhitespace(remainder.substr(1));
+  }
+
+  if (onlyStrings) {
+    argEncodedValue.kind = ValueKind::STRING_LIST;
+  } else if (onlyCells32) {
+    argEncodedValue.kind = ValueKind::CELLS_32;
+  } else if (onlyCells64) {
+    argEncodedValue.kind = ValueKind::CELLS_64;
+  } else {
+    argEncodedValue.kind = ValueKind::OTHER;
+  }
+}
+
+std::string EncodeValue(const std::string_view argValue) {
+  EncodedValue encodedValue;
+  EncodeComponents(argValue, encodedValue);
+  // References can only be resolved with knowledge of the whole tree
+  if (encodedValue.references.empty() == false) {
+    throw InvalidPropertyValueException{};
+  }
+  return std::move(encodedValue.data);
+}
+
+bool TryEncodeValue(const std::string_view argValue,
+                    EncodedValue &argEncodedValue) {
+  try {
+    EncodeComponents(argValue, argEncodedValue);
+  } catch (const InvalidPropertyValueException &) {
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VALUE_CODEC_H
+#define VALUE_CODEC_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Kinds of property values which can be stored in a typed representation
+enum class ValueKind {
+  CELLS_32,
+  CELLS_64,
+  OTHER,
+  STRING_LIST,
+};
+
+// Reference to a label in place of a 32 bit cell (e.g. "<&gic 0 1>")
+struct CellReference {
+  uint32_t cellIndex;
+  std::string_view label;
+};
+
+// Notation of an integer cell in device tree source, packing its radix, the
+// case of hexadecimal digits and its number of digits into a byte. Zero is the
+// notation in which dtc decompiles cells.
+constexpr uint8_t DTC_CELL_NOTATION = 0;
+
+struct EncodedValue {
+  // The binary (FDT) representation with zeroes in place of references
+  std::string data;
+  ValueKind kind = ValueKind::OTHER;
+  std::vector<CellReference> references;
+  // The notation of each cell as one byte
+  std::string cellNotations;
+};
+
+// Print a cell in the given notation
+void AppendCell(std::string &argOutput, uint64_t argCell, uint8_t argNotation);
+void AppendHexNumber(std::string &argOutput, uint64_t argNumber);
+void AppendQuotedStrings(std::string &argOutput, std::string_view argStrings);
+bool IsPrintableStringList(std::string_view argValue);
+
+// Convert a binary (FDT) property value into its device tree source
+// representation
+std::string DecodeValue(std::string_view argValue);
+// Convert a device tree source property value into its binary (FDT)
+// representation
+std::string EncodeValue(std::string_view argValue);
+// Like EncodeValue, but additionally classify the value and collect references
+// instead of failing on them. Returns false if the value is not supported.
+bool TryEncodeValue(std::string_view argValue, EncodedValue &argEncodedValue);
+
+#endif // VALUE_CODEC_H
@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "watch_session.h"
+#include "root_node.h"
+
+#include <algorithm>
+#include <iterator>
+
+WatchSession::WatchSession(const std::string &argFilePath1,
+                           const std::string &argFilePath2,
+                           const bool argParseInParallel)
+    : tree1{argFilePath1, argParseInParallel},
+      tree2{argFilePath2, argParseInParallel} {}
+
+WatchSession::~WatchSession() {}
+
+bool WatchSession::Start() {
+  if ((tree1.Update() == false) || (tree2.Update() == false)) {
+    return false;
+  }
+  DiffAll();
+  return true;
+}
+
+bool WatchSession::Update(const std::size_t argFileIndex) {
+  auto &tree = (argFileIndex == 0) ? tree1 : tree2;
+  if (tree.Update() == false) {
+    return false;
+  }
+
+  diffedPath.clear();
+  const auto reparsedNode = tree.GetReparsedNode();
+  if (reparsedNode == nullptr) {
+    return true;
+  }
+  if (reparsedNode == tree.GetRootNode()) {
+    DiffAll();
+    return true;
+  }
+  DiffChangedNode(*reparsedNode);
+  return true;
+}
+
+void WatchSession::DiffAll() {
+  differences = DiffEngine{}.Diff(*tree1.GetRootNode(), *tree2.GetRootNode());
+  diffedPath = "/";
+}
+
+std::vector<std::size_t>
+WatchSession::GetDifferencePosition(const Difference &argDifference) const {
+  // Find the node of the first tree below which the difference was found. For
+  // items only in the second tree it is the counterpart of their parent node.
+  const Node *parentNode1 = tree1.GetRootNode();
+  if (argDifference.item1 != nullptr) {
+    parentNode1 = static_cast<const Node *>(argDifference.item1->parent);
+  } else {
+    std::vector<const Node *> parentPath;
+    for (auto node = static_cast<const Node *>(argDifference.item2->parent);
+         node->GetType() != Item::Type::ROOT_NODE;
+         node = static_cast<const Node *>(node->parent)) {
+      parentPath.emplace_back(node);
+    }
+    for (auto it = parentPath.crbegin(); it != parentPath.crend(); ++it) {
+      parentNode1 = static_cast<const Node *>(
+          parentNode1->FindItem((*it)->GetNameId(), (*it)->GetUnitAddressId()));
+    }
+  }
+
+  auto position = GetNodePosition(*parentNode1);
+  const auto item = argDifference.item1 ? argDifference.item1
+                                        : argDifference.item2;
+  const auto item1 =
+      parentNode1->FindItem(item->GetNameId(), item->GetUnitAddressId());
+  const auto &items = parentNode1->GetItems();
+  position.emplace_back(
+      (item1 == nullptr)
+          ? items.size()
+          : static_cast<std::size_t>(
+                std::find(std::begin(items), std::end(items), item1) -
+                std::begin(items)));
+  return position;
+}
+
+std::vector<std::size_t> WatchSession::GetNodePosition(const Node &argNode) {
+  std::vector<std::size_t> position;
+  for (auto node = &argNode; node->GetType() != Item::Type::ROOT_NODE;
+       node = static_cast<const Node *>(node->parent)) {
+    const auto &items = static_cast<const Node *>(node->parent)->GetItems();
+    position.emplace_back(static_cast<std::size_t>(
+        std::find(std::begin(items), std::end(items), node) -
+        std::begin(items)));
+  }
+  std::reverse(std::begin(position), std::end(position));
+  return position;
+}
+
+void WatchSession::DiffChangedNode(const Node &argChangedNode) {
+  // Items of the same name are matched in order of their positions, so the
+  // differences of duplicates do not form a single run
+  const Node &rootNode1 = *tree1.GetRootNode();
+  const Node &rootNode2 = *tree2.GetRootNode();
+  if (rootNode1.hasDuplicateNames || rootNode2.hasDuplicateNames) {
+    DiffAll();
+    return;
+  }
+
+  // Follow the changed node's path down both trees as far as both hold it
+  std::vector<const Node *> changedPath;
+  for (auto node = &argChangedNode; node->GetType() != Item::Type::ROOT_NODE;
+       node = static_cast<const Node *>(node->parent)) {
+    changedPath.emplace_back(node);
+  }
+  const Node *node1 = &rootNode1;
+  const Node *node2 = &rootNode2;
+  std::string path{"/"};
+  for (auto it = changedPath.crbegin(); it != changedPath.crend(); ++it) {
+    const auto item1 =
+        node1->FindItem((*it)->GetNameId(), (*it)->GetUnitAddressId());
+    const auto item2 =
+        node2->FindItem((*it)->GetNameId(), (*it)->GetUnitAddressId());
+    if ((item1 == nullptr) || (item1->GetType() == Item::Type::PROPERTY) ||
+        (item2 == nullptr) || (item2->GetType() == Item::Type::PROPERTY)) {
+      break;
+    }
+    node1 = static_cast<const Node *>(item1);
+    node2 = static_cast<const Node *>(item2);
+    if (path.size() != 1) {
+      path.push_back('/');
+    }
+    path.append(node1->GetName());
+  }
+  if (path.size() == 1) {
+    DiffAll();
+    return;
+  }
+
+  // The differences of a subtree are a single run in the order of a full diff,
+  // which replaces the previous ones. Without any previous ones the run starts
+  // in front of the first difference following the subtree.
+  const auto isBelowPath = [&path](const Difference &argDifference) {
+    return (argDifference.path.compare(0, path.size(), path) == 0) &&
+           ((argDifference.path.size() == path.size()) ||
+            (argDifference.path[path.size()] == '/'));
+  };
+  auto runBegin = std::find_if(std::begin(differences), std::end(differences),
+                               isBelowPath);
+  auto runEnd = std::find_if_not(runBegin, std::end(differences), isBelowPath);
+  if (std::any_of(runEnd, std::end(differences), isBelowPath)) {
+    DiffAll();
+    return;
+  }
+  if (runBegin == runEnd) {
+    runBegin = runEnd = std::lower_bound(
+        std::begin(differences), std::end(differences),
+        GetNodePosition(*node1),
+        [this](const Difference &argDifference,
+               const std::vector<std::size_t> &argPosition) {
+          return GetDifferencePosition(argDifference) < argPosition;
+        });
+  }
+
+  auto newDifferences = DiffEngine{}.Diff(*node1, *node2, path);
+
+  const auto position =
+      differences.erase(runBegin, runEnd) - std::begin(differences);
+  differences.insert(std::begin(differences) + position,
+                     std::make_move_iterator(std::begin(newDifferences)),
+                     std::make_move_iterator(std::end(newDifferences)));
+  diffedPath = std::move(path);
+}
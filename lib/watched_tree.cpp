@@ -0,0 +1,348 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "watched_tree.h"
+#include "device_tree_parser.h"
+#include "line_reader.h"
+#include "root_node.h"
+#include "string_utils.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+// Return the size of the common prefix of two buffers. They are compared in
+// blocks first, as memcmp is far faster than comparing single bytes.
+static std::string_view::size_type
+GetCommonPrefixSize(const std::string_view argBuffer1,
+                    const std::string_view argBuffer2) {
+  constexpr std::string_view::size_type BLOCK_SIZE = 4096;
+
+  const auto size = std::min(argBuffer1.size(), argBuffer2.size());
+  std::string_view::size_type prefixSize = 0;
+  while ((size - prefixSize >= BLOCK_SIZE) &&
+         (std::memcmp(argBuffer1.data() + prefixSize,
+                      argBuffer2.data() + prefixSize, BLOCK_SIZE) == 0)) {
+    prefixSize += BLOCK_SIZE;
+  }
+  while ((prefixSize < size) &&
+         (argBuffer1[prefixSize] == argBuffer2[prefixSize])) {
+    ++prefixSize;
+  }
+  return prefixSize;
+}
+
+// Return the size of the common suffix of two buffers, which is at most the
+// given size
+static std::string_view::size_type
+GetCommonSuffixSize(const std::string_view argBuffer1,
+                    const std::string_view argBuffer2,
+                    const std::string_view::size_type argMaxSize) {
+  constexpr std::string_view::size_type BLOCK_SIZE = 4096;
+
+  const auto end1 = argBuffer1.data() + argBuffer1.size();
+  const auto end2 = argBuffer2.data() + argBuffer2.size();
+  std::string_view::size_type suffixSize = 0;
+  while ((argMaxSize - suffixSize >= BLOCK_SIZE) &&
+         (std::memcmp(end1 - suffixSize - BLOCK_SIZE,
+                      end2 - suffixSize - BLOCK_SIZE, BLOCK_SIZE) == 0)) {
+    suffixSize += BLOCK_SIZE;
+  }
+  while ((suffixSize < argMaxSize) &&
+         (*(end1 - suffixSize - 1) == *(end2 - suffixSize - 1))) {
+    ++suffixSize;
+  }
+  return suffixSize;
+}
+
+// Append the node and all nodes below it in pre-order
+static void CollectNodes(Node &argNode, std::vector<Node *> &argNodes) {
+  argNodes.emplace_back(&argNode);
+  for (const auto item : argNode.GetItems()) {
+    if (item->GetType() != Item::Type::PROPERTY) {
+      CollectNodes(*static_cast<Node *>(item), argNodes);
+    }
+  }
+}
+
+WatchedTree::WatchedTree(const std::string &argFilePath,
+                         const bool argParseInParallel)
+    : filePath{argFilePath}, parseInParallel{argParseInParallel} {}
+
+WatchedTree::~WatchedTree() {}
+
+bool WatchedTree::IsModified() const {
+  struct stat fileStatus;
+  if (stat(filePath.c_str(), &fileStatus) != 0) {
+    return false;
+  }
+  const auto newModificationTime =
+      static_cast<int64_t>(fileStatus.st_mtim.tv_sec) * 1000000000 +
+      fileStatus.st_mtim.tv_nsec;
+  return (newModificationTime != modificationTime) ||
+         (static_cast<int64_t>(fileStatus.st_size) != fileSize);
+}
+
+bool WatchedTree::Update() {
+  // The file's status is taken before reading it, so that modifications while
+  // reading are caught by the next update
+  struct stat fileStatus;
+  if (stat(filePath.c_str(), &fileStatus) != 0) {
+    std::cerr << "Failed to open device tree file: " << filePath << "\n";
+    return false;
+  }
+  modificationTime =
+      static_cast<int64_t>(fileStatus.st_mtim.tv_sec) * 1000000000 +
+      fileStatus.st_mtim.tv_nsec;
+  fileSize = static_cast<int64_t>(fileStatus.st_size);
+
+  // The content is copied instead of mapped, as it is compared to the next
+  // version of the file, which may be written in place
+  std::ifstream inputFile{filePath, std::ios_base::binary};
+  if (inputFile.fail()) {
+    std::cerr << "Failed to open device tree file: " << filePath << "\n";
+    return false;
+  }
+  // Reading into the buffer of the previous content avoids faulting in the
+  // pages of a new one, which takes longer than reading
+  nextBuffer.resize(static_cast<std::string::size_type>(fileSize));
+  inputFile.read(nextBuffer.data(), static_cast<std::streamsize>(fileSize));
+  nextBuffer.resize(static_cast<std::string::size_type>(inputFile.gcount()));
+  if (inputFile.bad()) {
+    std::cerr << "Failed to read file: " << filePath << "\n";
+    return false;
+  }
+
+  const auto prefixSize = GetCommonPrefixSize(buffer, nextBuffer);
+  if (rootNode && (prefixSize == buffer.size()) &&
+      (prefixSize == nextBuffer.size())) {
+    reparsedNode = nullptr;
+    return true;
+  }
+
+  // The arena only frees the replaced nodes with the whole tree, which is
+  // thus parsed again once as much as the file's size has been re-parsed
+  if ((rootNode == nullptr) || (reparsedSize > buffer.size()) ||
+      (ParseChangedNode(nextBuffer, prefixSize) == false)) {
+    if (ParseFile(nextBuffer) == false) {
+      return false;
+    }
+  }
+  std::swap(buffer, nextBuffer);
+  return true;
+}
+
+bool WatchedTree::ParseChangedNode(
+    const std::string_view argNewBuffer,
+    const std::string_view::size_type argPrefixSize) {
+  if (nodeRanges.empty()) {
+    return false;
+  }
+
+  // The changes replace the bytes between the common prefix and suffix
+  const auto suffixSize =
+      GetCommonSuffixSize(buffer, argNewBuffer,
+                          std::min(buffer.size(), argNewBuffer.size()) -
+                              argPrefixSize);
+  const auto changeEnd = buffer.size() - suffixSize;
+  const auto sizeDelta = argNewBuffer.size() - buffer.size();
+
+  // Start at the last node starting before the changes and walk up to the
+  // first one also enclosing their end. Its end line must stay untouched.
+  auto rangeIt =
+      std::upper_bound(std::begin(nodeRanges), std::end(nodeRanges),
+                       argPrefixSize,
+                       [](const std::string::size_type argOffset,
+                          const NodeRange &argRange) {
+                         return argOffset < argRange.begin;
+                       });
+  if (rangeIt == std::begin(nodeRanges)) {
+    return false;
+  }
+  auto rangeIndex =
+      static_cast<std::size_t>(std::prev(rangeIt) - std::begin(nodeRanges));
+  while ((rangeIndex != NO_PARENT) &&
+         ((argPrefixSize > nodeRanges[rangeIndex].endLineBegin) ||
+          (changeEnd > nodeRanges[rangeIndex].endLineBegin))) {
+    rangeIndex = nodeRanges[rangeIndex].parentIndex;
+  }
+
+  // Insertions in front of a node or changes of its start line may make the
+  // node's new source contain more or other nodes, in which case the parent
+  // node is tried instead. The root node is only parsed with the whole file.
+  std::vector<NodeRange> newRanges;
+  for (; (rangeIndex != NO_PARENT) &&
+         (nodeRanges[rangeIndex].parentIndex != NO_PARENT);
+       rangeIndex = nodeRanges[rangeIndex].parentIndex) {
+    const auto &range = nodeRanges[rangeIndex];
+    const auto newSource = argNewBuffer.substr(
+        range.begin, range.end + sizeDelta - range.begin);
+    newRanges.clear();
+    if ((ScanNodeRanges(newSource, newRanges) == false) ||
+        (newRanges.front().begin != 0) ||
+        (newRanges.front().end != newSource.size()) ||
+        (std::count_if(std::begin(newRanges), std::end(newRanges),
+                       [](const NodeRange &argRange) {
+                         return argRange.parentIndex == NO_PARENT;
+                       }) != 1)) {
+      continue;
+    }
+    break;
+  }
+  if ((rangeIndex == NO_PARENT) ||
+      (nodeRanges[rangeIndex].parentIndex == NO_PARENT)) {
+    return false;
+  }
+
+  const auto oldNode = nodeRanges[rangeIndex].node;
+  const auto parentIndex = nodeRanges[rangeIndex].parentIndex;
+  const auto parentNode = nodeRanges[parentIndex].node;
+  const auto begin = nodeRanges[rangeIndex].begin;
+  LineReader lineReader{argNewBuffer.substr(
+      begin, nodeRanges[rangeIndex].end + sizeDelta - begin)};
+  std::string_view line;
+  lineReader.GetLine(line);
+  // Throws on invalid lines before anything has been modified
+  const auto newNode =
+      rootNode->GetArena().Create<Node>(line, lineReader, parentNode,
+                                        rootNode->GetArena());
+
+  std::vector<Node *> newNodes;
+  CollectNodes(*newNode, newNodes);
+  if (newNodes.size() != newRanges.size()) {
+    return false;
+  }
+
+  // Swap the new node in and update its ancestors. The child index only
+  // changes if the node has been renamed.
+  *std::find(std::begin(parentNode->items), std::end(parentNode->items),
+             oldNode) = newNode;
+  if (newNode->HasSameName(*oldNode) == false) {
+    parentNode->BuildChildIndex();
+  }
+  for (auto ancestorIndex = parentIndex; ancestorIndex != NO_PARENT;
+       ancestorIndex = nodeRanges[ancestorIndex].parentIndex) {
+    nodeRanges[ancestorIndex].node->UpdateHash();
+    nodeRanges[ancestorIndex].endLineBegin += sizeDelta;
+    nodeRanges[ancestorIndex].end += sizeDelta;
+  }
+  rootNode->InvalidatePathIndex();
+
+  // Replace the ranges of the old subtree by the new ones and move the ranges
+  // of the following nodes, which keep their relative order
+  auto oldRangesEnd = rangeIndex + 1;
+  while ((oldRangesEnd < nodeRanges.size()) &&
+         (nodeRanges[oldRangesEnd].begin < nodeRanges[rangeIndex].end)) {
+    ++oldRangesEnd;
+  }
+  const auto indexDelta = newRanges.size() - (oldRangesEnd - rangeIndex);
+  for (auto i = oldRangesEnd; i < nodeRanges.size(); ++i) {
+    auto &range = nodeRanges[i];
+    range.begin += sizeDelta;
+    range.endLineBegin += sizeDelta;
+    range.end += sizeDelta;
+    if (range.parentIndex >= oldRangesEnd) {
+      range.parentIndex += indexDelta;
+    }
+  }
+  for (std::vector<NodeRange>::size_type i = 0; i < newRanges.size(); ++i) {
+    auto &range = newRanges[i];
+    range.node = newNodes[i];
+    range.parentIndex =
+        (range.parentIndex == NO_PARENT) ? parentIndex
+                                         : range.parentIndex + rangeIndex;
+    range.begin += begin;
+    range.endLineBegin += begin;
+    range.end += begin;
+  }
+  nodeRanges.erase(std::begin(nodeRanges) + rangeIndex,
+                   std::begin(nodeRanges) + oldRangesEnd);
+  nodeRanges.insert(std::begin(nodeRanges) + rangeIndex,
+                    std::begin(newRanges), std::end(newRanges));
+
+  // A renamed node changes the paths below its parent
+  reparsedNode = newNode->HasSameName(*oldNode) ? newNode : parentNode;
+  reparsedSize += newRanges.front().end - newRanges.front().begin;
+  return true;
+}
+
+bool WatchedTree::ParseFile(const std::string_view argNewBuffer) {
+  DeviceTreeParser parser{filePath, parseInParallel};
+  auto newRootNode = parser.ParseBuffer(argNewBuffer);
+  if (newRootNode == nullptr) {
+    return false;
+  }
+
+  // Incremental parsing is only possible if each node can be told by its
+  // range, which is not the case for e.g. multiple root nodes
+  std::vector<NodeRange> newRanges;
+  std::vector<Node *> newNodes;
+  CollectNodes(*newRootNode, newNodes);
+  if ((ScanNodeRanges(argNewBuffer, newRanges) == false) ||
+      (newRanges.size() != newNodes.size())) {
+    newRanges.clear();
+  }
+  for (std::vector<NodeRange>::size_type i = 0; i < newRanges.size(); ++i) {
+    newRanges[i].node = newNodes[i];
+  }
+
+  rootNode = std::move(newRootNode);
+  nodeRanges = std::move(newRanges);
+  reparsedNode = rootNode.get();
+  reparsedSize = 0;
+  return true;
+}
+
+bool WatchedTree::ScanNodeRanges(const std::string_view argBuffer,
+                                 std::vector<NodeRange> &argNodeRanges) {
+  LineReader lineReader{argBuffer};
+  std::vector<std::size_t> openRanges;
+  std::string_view line;
+  while (true) {
+    const auto lineBegin = lineReader.GetOffset();
+    if (lineReader.GetLine(line) == false) {
+      break;
+    }
+    if (RemoveLeadingWhitespace(line).empty()) {
+      continue;
+    }
+    if (Node::IsNodeStartLine(line)) {
+      argNodeRanges.push_back(
+          {nullptr, openRanges.empty() ? NO_PARENT : openRanges.back(),
+           lineBegin, 0, 0});
+      openRanges.emplace_back(argNodeRanges.size() - 1);
+      continue;
+    }
+    if (Node::IsNodeEndLine(line) && (openRanges.empty() == false)) {
+      auto &range = argNodeRanges[openRanges.back()];
+      range.endLineBegin = lineBegin;
+      range.end = std::min(lineReader.GetOffset(), argBuffer.size());
+      openRanges.pop_back();
+    }
+  }
+  return openRanges.empty() && (argNodeRanges.empty() == false);
+}
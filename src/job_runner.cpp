@@ -0,0 +1,1000 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "job_runner.h"
+#include "corpus_index.h"
+#include "device_tree_parser.h"
+#include "diff_engine.h"
+#include "dtb_parser.h"
+#include "dtb_writer.h"
+#include "file_watcher.h"
+#include "flat_tree.h"
+#include "json.h"
+#include "json_parser.h"
+#include "json_writer.h"
+#include "overlay_applier.h"
+#include "parse_cache.h"
+#include "patch.h"
+#include "root_node.h"
+#include "thread_pool.h"
+#include "three_way_merge.h"
+#include "watch_session.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+
+// Exit status of jobs which were aborted by an exception
+constexpr int JOB_EXCEPTION_STATUS = 9;
+
+// Parse either a device tree source, a device tree blob or a JSON file,
+// depending on whether the file starts with the FDT magic number or an object.
+// The parser's diagnostics are written to the given error stream, so files
+// parsed concurrently need one each.
+static std::unique_ptr<RootNode>
+ParseDeviceTree(const std::string &argFile, const bool argParseInParallel,
+                const ParseCache *const argParseCache,
+                ThreadPool &argThreadPool, std::ostream &argErrorStream) {
+  if (DtbParser::IsDtbFile(argFile)) {
+    DtbParser parser{argFile, argErrorStream};
+    return parser.ParseFile();
+  }
+  if (JsonParser::IsJsonFile(argFile)) {
+    JsonParser parser{argFile, argErrorStream};
+    return parser.ParseFile();
+  }
+
+  DeviceTreeParser parser{argFile, argParseInParallel, argParseCache,
+                          &argThreadPool, argErrorStream};
+  return parser.ParseFile();
+}
+
+// Print a resulting device tree in the requested representation
+static void PrintTree(const RootNode &argRootNode,
+                      const OutputFormat argOutputFormat,
+                      std::ostream &argOutputStream) {
+  switch (argOutputFormat) {
+  case OutputFormat::DTS:
+    argRootNode.Print(argOutputStream);
+    break;
+  case OutputFormat::JSON:
+    JsonWriter{argOutputStream, JsonWriter::Format::DOCUMENT}.Write(
+        argRootNode);
+    break;
+  case OutputFormat::JSON_LINES:
+    JsonWriter{argOutputStream, JsonWriter::Format::NODE_LINES}.Write(
+        argRootNode);
+    break;
+  }
+}
+
+// Return diagnostics of possibly multiple lines on a single line
+static std::string JoinLines(std::string argText) {
+  while ((argText.empty() == false) && (argText.back() == '\n')) {
+    argText.pop_back();
+  }
+  std::string::size_type pos = 0;
+  while ((pos = argText.find('\n', pos)) != std::string::npos) {
+    argText.replace(pos, 1, "; ");
+  }
+  return argText;
+}
+
+// Compare each candidate file against the same baseline tree, which is only
+// read and thus shared by the concurrently running comparisons. A summary with
+// one result per candidate is printed in the order of the candidates.
+static int CompareAgainstBaseline(
+    const RootNode &argBaseline,
+    const std::vector<std::string> &argCandidateFiles,
+    const bool argParseInParallel, const ParseCache *const argParseCache,
+    const bool argFlatCompare, const bool argVerifyHashMatches,
+    ThreadPool &argThreadPool, std::ostream &argOutputStream) {
+  enum class Result { DIFFERENT, EQUAL, FAILED };
+
+  std::unique_ptr<FlatTree> flatBaseline;
+  if (argFlatCompare) {
+    flatBaseline = std::make_unique<FlatTree>(argBaseline);
+  }
+
+  std::vector<Result> results(argCandidateFiles.size(), Result::FAILED);
+  std::vector<std::string> errors(argCandidateFiles.size());
+  {
+    TaskGroup taskGroup{argThreadPool};
+    for (std::vector<std::string>::size_type i = 0;
+         i < argCandidateFiles.size(); ++i) {
+      taskGroup.Run([&, i]() {
+        try {
+          std::ostringstream errorStream;
+          const auto candidate =
+              ParseDeviceTree(argCandidateFiles[i], argParseInParallel,
+                              argParseCache, argThreadPool, errorStream);
+          if (!candidate) {
+            errors[i] = JoinLines(errorStream.str());
+            return;
+          }
+          bool isEqual = false;
+          if (flatBaseline) {
+            isEqual = flatBaseline->Compare(FlatTree{*candidate});
+          } else if (argVerifyHashMatches) {
+            isEqual = argBaseline.CompareVerified(candidate.get());
+          } else {
+            isEqual = argBaseline.Compare(candidate.get());
+          }
+          results[i] = isEqual ? Result::EQUAL : Result::DIFFERENT;
+        } catch (const std::exception &argException) {
+          errors[i] = argException.what();
+        }
+      });
+    }
+    taskGroup.Wait();
+  }
+
+  std::vector<Result>::size_type equalQty = 0;
+  std::vector<Result>::size_type failedQty = 0;
+  for (std::vector<Result>::size_type i = 0; i < results.size(); ++i) {
+    argOutputStream << argCandidateFiles[i] << ": ";
+    switch (results[i]) {
+    case Result::DIFFERENT:
+      argOutputStream << "different\n";
+      break;
+    case Result::EQUAL:
+      argOutputStream << "equal\n";
+      ++equalQty;
+      break;
+    case Result::FAILED:
+      argOutputStream << "failed";
+      if (errors[i].empty() == false) {
+        argOutputStream << " (" << errors[i] << ")";
+      }
+      argOutputStream << "\n";
+      ++failedQty;
+      break;
+    }
+  }
+  argOutputStream << results.size() << " files compared: " << equalQty
+                  << " equal, " << results.size() - equalQty - failedQty
+                  << " different, " << failedQty << " failed\n";
+
+  if (failedQty != 0) {
+    return 5;
+  }
+  if (equalQty != results.size()) {
+    return 1;
+  }
+  return 0;
+}
+
+// Apply the overlays to the base tree in order and print or write the result
+static int ApplyOverlays(const std::vector<std::string> &argFiles,
+                         const bool argParseInParallel,
+                         const ParseCache *const argParseCache,
+                         const std::string &argDtbOutputFile,
+                         const OutputFormat argOutputFormat,
+                         ThreadPool &argThreadPool,
+                         std::ostream &argOutputStream,
+                         std::ostream &argErrorStream) {
+  // All files are parsed up front on the thread pool, while applying the
+  // overlays is sequential
+  std::vector<std::unique_ptr<RootNode>> rootNodes(argFiles.size());
+  std::vector<std::ostringstream> diagnostics(argFiles.size());
+  std::vector<std::string> errors(argFiles.size());
+  {
+    TaskGroup taskGroup{argThreadPool};
+    for (std::vector<std::string>::size_type i = 0; i < argFiles.size();
+         ++i) {
+      taskGroup.Run([&, i]() {
+        try {
+          rootNodes[i] =
+              ParseDeviceTree(argFiles[i], argParseInParallel, argParseCache,
+                              argThreadPool, diagnostics[i]);
+        } catch (const std::exception &argException) {
+          errors[i] = argException.what();
+        }
+      });
+    }
+    taskGroup.Wait();
+  }
+  for (std::vector<std::string>::size_type i = 0; i < argFiles.size(); ++i) {
+    argErrorStream << diagnostics[i].str();
+    if (!rootNodes[i]) {
+      argErrorStream << "Failed to parse file: " << argFiles[i];
+      if (errors[i].empty() == false) {
+        argErrorStream << " (" << errors[i] << ")";
+      }
+      argErrorStream << "\n";
+      return (i == 0) ? 4 : 5;
+    }
+  }
+
+  auto &baseRootNode = *rootNodes.front();
+  OverlayApplier overlayApplier{baseRootNode, argErrorStream};
+  for (std::vector<std::string>::size_type i = 1; i < argFiles.size(); ++i) {
+    if (overlayApplier.Apply(*rootNodes[i]) == false) {
+      argErrorStream << "Failed to apply overlay: " << argFiles[i] << "\n";
+      return 5;
+    }
+  }
+
+  if (!argDtbOutputFile.empty()) {
+    DtbWriter writer{argDtbOutputFile, argErrorStream};
+    if (writer.WriteFile(baseRootNode) == false) {
+      return 8;
+    }
+    return 0;
+  }
+  PrintTree(baseRootNode, argOutputFormat, argOutputStream);
+  return 0;
+}
+
+// Parse each file once on the thread pool and print the clusters of identical
+// and nearly identical trees as JSON objects, one per line
+static int ClusterFiles(const std::vector<std::string> &argFiles,
+                        const bool argParseInParallel,
+                        const ParseCache *const argParseCache,
+                        ThreadPool &argThreadPool,
+                        std::ostream &argOutputStream,
+                        std::ostream &argErrorStream) {
+  // Only the fingerprints are kept, so that the trees can be freed right away
+  std::vector<std::unique_ptr<CorpusIndex::Fingerprint>> fingerprints(
+      argFiles.size());
+  std::vector<std::ostringstream> diagnostics(argFiles.size());
+  std::vector<std::string> errors(argFiles.size());
+  {
+    TaskGroup taskGroup{argThreadPool};
+    for (std::vector<std::string>::size_type i = 0; i < argFiles.size();
+         ++i) {
+      taskGroup.Run([&, i]() {
+        try {
+          const auto rootNode =
+              ParseDeviceTree(argFiles[i], argParseInParallel, argParseCache,
+                              argThreadPool, diagnostics[i]);
+          if (rootNode) {
+            fingerprints[i] = std::make_unique<CorpusIndex::Fingerprint>(
+                CorpusIndex::ComputeFingerprint(*rootNode));
+          }
+        } catch (const std::exception &argException) {
+          errors[i] = argException.what();
+        }
+      });
+    }
+    taskGroup.Wait();
+  }
+
+  CorpusIndex corpusIndex;
+  std::vector<std::vector<std::string>::size_type> fileIdxs;
+  bool failed = false;
+  for (std::vector<std::string>::size_type i = 0; i < argFiles.size(); ++i) {
+    argErrorStream << diagnostics[i].str();
+    if (!fingerprints[i]) {
+      argErrorStream << "Failed to parse file: " << argFiles[i];
+      if (errors[i].empty() == false) {
+        argErrorStream << " (" << errors[i] << ")";
+      }
+      argErrorStream << "\n";
+      failed = true;
+      continue;
+    }
+    corpusIndex.Add(*fingerprints[i]);
+    fileIdxs.emplace_back(i);
+  }
+
+  for (const auto &cluster : corpusIndex.GetClusters()) {
+    std::string line{"{\"similarity\":" +
+                     std::to_string(cluster.similarity) + ",\"groups\":["};
+    for (const auto &group : cluster.groups) {
+      if (&group != &cluster.groups.front()) {
+        line.push_back(',');
+      }
+      line.push_back('[');
+      for (const auto treeIdx : group) {
+        if (treeIdx != group.front()) {
+          line.push_back(',');
+        }
+        AppendJsonString(line, argFiles[fileIdxs[treeIdx]]);
+      }
+      line.push_back(']');
+    }
+    line.append("]}");
+    argOutputStream << line << "\n";
+  }
+
+  if (failed) {
+    return 5;
+  }
+  return 0;
+}
+
+// Merge the changes of OURS and THEIRS relative to BASE and print or write the
+// result. Conflicts are printed as JSON objects, one per line, to the error
+// stream.
+static int MergeThreeWay(const std::string &argBaseFile,
+                         const std::string &argOurFile,
+                         const std::string &argTheirFile,
+                         const bool argParseInParallel,
+                         const ParseCache *const argParseCache,
+                         const std::string &argDtbOutputFile,
+                         const OutputFormat argOutputFormat,
+                         ThreadPool &argThreadPool,
+                         std::ostream &argOutputStream,
+                         std::ostream &argErrorStream) {
+  // Parse all three files concurrently
+  std::unique_ptr<RootNode> baseRootNode;
+  std::unique_ptr<RootNode> theirRootNode;
+  std::unique_ptr<RootNode> ourRootNode;
+  std::ostringstream baseErrorStream;
+  std::ostringstream theirErrorStream;
+  {
+    TaskGroup taskGroup{argThreadPool};
+    taskGroup.Run([&]() {
+      baseRootNode = ParseDeviceTree(argBaseFile, argParseInParallel,
+                                     argParseCache, argThreadPool,
+                                     baseErrorStream);
+    });
+    taskGroup.Run([&]() {
+      theirRootNode = ParseDeviceTree(argTheirFile, argParseInParallel,
+                                      argParseCache, argThreadPool,
+                                      theirErrorStream);
+    });
+    ourRootNode = ParseDeviceTree(argOurFile, argParseInParallel,
+                                  argParseCache, argThreadPool, argErrorStream);
+    taskGroup.Wait();
+  }
+  argErrorStream << baseErrorStream.str() << theirErrorStream.str();
+  if (!ourRootNode) {
+    argErrorStream << "Failed to parse file: " << argOurFile << "\n";
+    return 4;
+  }
+  if (!baseRootNode) {
+    argErrorStream << "Failed to parse file: " << argBaseFile << "\n";
+    return 4;
+  }
+  if (!theirRootNode) {
+    argErrorStream << "Failed to parse file: " << argTheirFile << "\n";
+    return 5;
+  }
+
+  ThreeWayMerge threeWayMerge;
+  const auto conflicts =
+      threeWayMerge.Merge(*ourRootNode, *baseRootNode, *theirRootNode);
+  for (const auto &conflict : conflicts) {
+    argErrorStream << conflict.GetJsonLine() << "\n";
+  }
+
+  if (!argDtbOutputFile.empty()) {
+    DtbWriter writer{argDtbOutputFile, argErrorStream};
+    if (writer.WriteFile(*ourRootNode) == false) {
+      return 8;
+    }
+  } else {
+    PrintTree(*ourRootNode, argOutputFormat, argOutputStream);
+  }
+
+  if (conflicts.empty()) {
+    return 0;
+  }
+  return 1;
+}
+
+// Write end of the pipe through which termination signals stop watching
+static int terminationPipeWriteFd = -1;
+
+static void HandleTerminationSignal(const int argSignal) {
+  (void)argSignal;
+  const char signalByte = 0;
+  // Nothing can be done about a failed write in a signal handler
+  const auto result = write(terminationPipeWriteFd, &signalByte, 1);
+  (void)result;
+}
+
+// Print the differences of the two files and a summary line whenever either of
+// them has been modified. Only the changed parts of the files are parsed and
+// diffed again. Runs until SIGINT or SIGTERM is received and returns the result
+// of the last comparison then.
+static int WatchFiles(const std::vector<std::string> &argFiles,
+                      const bool argParseInParallel,
+                      std::ostream &argOutputStream,
+                      std::ostream &argErrorStream) {
+  using Clock = std::chrono::steady_clock;
+
+  const auto printDifferences = [&argOutputStream](
+                                    const WatchSession &argSession,
+                                    const WatchedTree *const argTree,
+                                    const Clock::time_point argStartTime) {
+    const auto milliseconds =
+        std::chrono::duration<double, std::milli>(Clock::now() - argStartTime)
+            .count();
+    std::string output;
+    for (const auto &difference : argSession.GetDifferences()) {
+      output.append(difference.GetJsonLine());
+      output.push_back('\n');
+    }
+    output.append("{\"type\":\"summary\"");
+    if (argTree != nullptr) {
+      output.append(",\"file\":");
+      AppendJsonString(output, argTree->GetFilePath());
+      output.append(",\"reparsed\":");
+      AppendJsonString(output, argTree->GetReparsedNode()->GetDevicePath());
+      output.append(",\"diffed\":");
+      AppendJsonString(output, argSession.GetDiffedPath());
+    }
+    output.append(",\"differences\":" +
+                  std::to_string(argSession.GetDifferences().size()) +
+                  ",\"milliseconds\":" + std::to_string(milliseconds) +
+                  "}\n");
+    argOutputStream << output << std::flush;
+  };
+
+  WatchSession session{argFiles.front(), argFiles.back(), argParseInParallel};
+  const auto startTime = Clock::now();
+  if (session.Start() == false) {
+    const auto isFirstFile = session.GetTree(0).GetRootNode() == nullptr;
+    argErrorStream << "Failed to parse file: "
+                   << (isFirstFile ? argFiles.front() : argFiles.back())
+                   << "\n";
+    return isFirstFile ? 4 : 5;
+  }
+  printDifferences(session, nullptr, startTime);
+
+  int terminationPipeFds[2];
+  if (pipe2(terminationPipeFds, O_CLOEXEC | O_NONBLOCK) != 0) {
+    argErrorStream << "Failed to create pipe for watching files\n";
+    return 2;
+  }
+  terminationPipeWriteFd = terminationPipeFds[1];
+  struct sigaction terminationAction {};
+  terminationAction.sa_handler = HandleTerminationSignal;
+  sigemptyset(&terminationAction.sa_mask);
+  struct sigaction previousInterruptAction {};
+  struct sigaction previousTerminationAction {};
+  sigaction(SIGINT, &terminationAction, &previousInterruptAction);
+  sigaction(SIGTERM, &terminationAction, &previousTerminationAction);
+
+  FileWatcher fileWatcher{argFiles};
+  while (fileWatcher.Wait(terminationPipeFds[0]) == true) {
+    for (std::size_t i = 0; i < 2; ++i) {
+      const auto &tree = session.GetTree(i);
+      if (tree.IsModified() == false) {
+        continue;
+      }
+      // Files are invalid while being edited, which is reported until they
+      // have been fixed
+      const auto updateStartTime = Clock::now();
+      try {
+        if (session.Update(i) == false) {
+          argErrorStream << "Failed to parse file: " << tree.GetFilePath()
+                         << "\n";
+          continue;
+        }
+      } catch (const std::exception &argException) {
+        argErrorStream << "Failed to parse file: " << tree.GetFilePath()
+                       << ": " << argException.what() << "\n";
+        continue;
+      }
+      if (tree.GetReparsedNode() != nullptr) {
+        printDifferences(session, &tree, updateStartTime);
+      }
+    }
+  }
+
+  sigaction(SIGINT, &previousInterruptAction, nullptr);
+  sigaction(SIGTERM, &previousTerminationAction, nullptr);
+  terminationPipeWriteFd = -1;
+  close(terminationPipeFds[0]);
+  close(terminationPipeFds[1]);
+
+  if (session.GetDifferences().empty()) {
+    return 0;
+  }
+  return 1;
+}
+
+JobOptions ParseJobOptions(const std::vector<std::string> &argArguments) {
+  JobOptions options;
+  std::vector<std::string>::size_type i = 0;
+  for (; i < argArguments.size(); ++i) {
+    const auto &argument = argArguments[i];
+    if ((argument.empty() == false) && (argument[0] != '-')) {
+      break;
+    }
+    if ((argument == "-3") && (i + 1 < argArguments.size())) {
+      options.baseFile = argArguments[++i];
+      continue;
+    }
+    if ((argument == "-b") && (i + 1 < argArguments.size())) {
+      options.manifestFile = argArguments[++i];
+      continue;
+    }
+    if ((argument == "-c") && (i + 1 < argArguments.size())) {
+      options.cacheDirectory = argArguments[++i];
+      continue;
+    }
+    if ((argument == "-d") && (i + 1 < argArguments.size())) {
+      options.dtbOutputFile = argArguments[++i];
+      continue;
+    }
+    if (argument == "-a") {
+      options.applyOverlays = true;
+    }
+    if ((argument == "-u") && (i + 1 < argArguments.size())) {
+      options.patchOutputFile = argArguments[++i];
+      continue;
+    }
+    if ((argument == "-x") && (i + 1 < argArguments.size())) {
+      options.patchFile = argArguments[++i];
+      continue;
+    }
+    if (argument == "-e") {
+      options.extend = true;
+    }
+    if (argument == "-f") {
+      options.flatCompare = true;
+    }
+    if (argument == "-g") {
+      options.clusterFiles = true;
+    }
+    if (argument == "-h") {
+      options.displayHelp = true;
+      return options;
+    }
+    if (argument == "-j") {
+      options.outputFormat = OutputFormat::JSON;
+    }
+    if (argument == "-J") {
+      options.outputFormat = OutputFormat::JSON_LINES;
+    }
+    if (argument == "-l") {
+      options.listDifferences = true;
+    }
+    if (argument == "-m") {
+      options.compare = false;
+      options.merge_file_2_into_file_1 = true;
+    }
+    if (argument == "-n") {
+      options.multipleCandidates = true;
+    }
+    if (argument == "-p") {
+      options.purge = true;
+    }
+    if (argument == "-s") {
+      options.stopAtFirstDifference = true;
+    }
+    if (argument == "-t") {
+      options.parseInParallel = true;
+    }
+    if (argument == "-v") {
+      options.verifyHashMatches = true;
+    }
+    if (argument == "-w") {
+      options.watchFiles = true;
+    }
+  }
+  options.files.assign(std::begin(argArguments) + i, std::end(argArguments));
+  return options;
+}
+
+int RunJob(const JobOptions &argOptions, std::ostream &argOutputStream,
+           std::ostream &argErrorStream, ThreadPool *argThreadPool) {
+  // Jobs of a manifest share its thread pool, which bounds the number of
+  // threads of all of them together
+  std::unique_ptr<ThreadPool> ownThreadPool;
+  if (argThreadPool == nullptr) {
+    ownThreadPool = std::make_unique<ThreadPool>();
+    argThreadPool = ownThreadPool.get();
+  }
+  auto &threadPool = *argThreadPool;
+
+  std::unique_ptr<ParseCache> parseCache;
+  if (argOptions.cacheDirectory.empty() == false) {
+    parseCache = std::make_unique<ParseCache>(argOptions.cacheDirectory);
+  }
+
+  if (argOptions.applyOverlays) {
+    return ApplyOverlays(argOptions.files, argOptions.parseInParallel,
+                         parseCache.get(), argOptions.dtbOutputFile,
+                         argOptions.outputFormat, threadPool, argOutputStream,
+                         argErrorStream);
+  }
+
+  if (argOptions.patchFile.empty() == false) {
+    const auto &file = argOptions.files.back();
+    const auto rootNode =
+        ParseDeviceTree(file, argOptions.parseInParallel, parseCache.get(),
+                        threadPool, argErrorStream);
+    if (!rootNode) {
+      argErrorStream << "Failed to parse file: " << file << "\n";
+      return 4;
+    }
+    PatchApplier patchApplier{argOptions.patchFile, argErrorStream};
+    if (patchApplier.ApplyFile(*rootNode) == false) {
+      return 5;
+    }
+    if (!argOptions.dtbOutputFile.empty()) {
+      DtbWriter writer{argOptions.dtbOutputFile, argErrorStream};
+      if (writer.WriteFile(*rootNode) == false) {
+        return 8;
+      }
+      return 0;
+    }
+    PrintTree(*rootNode, argOptions.outputFormat, argOutputStream);
+    return 0;
+  }
+
+  if (argOptions.watchFiles) {
+    return WatchFiles(argOptions.files, argOptions.parseInParallel,
+                      argOutputStream, argErrorStream);
+  }
+
+  if (argOptions.clusterFiles) {
+    return ClusterFiles(argOptions.files, argOptions.parseInParallel,
+                        parseCache.get(), threadPool, argOutputStream,
+                        argErrorStream);
+  }
+
+  if (argOptions.baseFile.empty() == false) {
+    return MergeThreeWay(argOptions.baseFile,
+                         argOptions.files[argOptions.files.size() - 2],
+                         argOptions.files[argOptions.files.size() - 1],
+                         argOptions.parseInParallel, parseCache.get(),
+                         argOptions.dtbOutputFile, argOptions.outputFormat,
+                         threadPool, argOutputStream, argErrorStream);
+  }
+
+  if (argOptions.multipleCandidates) {
+    const auto &baselineFile = argOptions.files.front();
+    const auto baseline =
+        ParseDeviceTree(baselineFile, argOptions.parseInParallel,
+                        parseCache.get(), threadPool, argErrorStream);
+    if (!baseline) {
+      argErrorStream << "Failed to parse file: " << baselineFile << "\n";
+      return 4;
+    }
+    return CompareAgainstBaseline(
+        *baseline,
+        {std::begin(argOptions.files) + 1, std::end(argOptions.files)},
+        argOptions.parseInParallel, parseCache.get(), argOptions.flatCompare,
+        argOptions.verifyHashMatches, threadPool, argOutputStream);
+  }
+
+  // A single file is only given to export it
+  if (argOptions.files.size() == 1) {
+    const auto &file = argOptions.files.front();
+    const auto rootNode =
+        ParseDeviceTree(file, argOptions.parseInParallel, parseCache.get(),
+                        threadPool, argErrorStream);
+    if (!rootNode) {
+      argErrorStream << "Failed to parse file: " << file << "\n";
+      return 4;
+    }
+    PrintTree(*rootNode, argOptions.outputFormat, argOutputStream);
+    return 0;
+  }
+
+  const auto &file1 = argOptions.files[argOptions.files.size() - 2];
+  const auto &file2 = argOptions.files[argOptions.files.size() - 1];
+
+  // Parse both files concurrently
+  std::unique_ptr<RootNode> rootNode1;
+  std::unique_ptr<RootNode> rootNode2;
+  std::ostringstream errorStream2;
+  {
+    TaskGroup taskGroup{threadPool};
+    taskGroup.Run([&]() {
+      rootNode2 = ParseDeviceTree(file2, argOptions.parseInParallel,
+                                  parseCache.get(), threadPool, errorStream2);
+    });
+    rootNode1 = ParseDeviceTree(file1, argOptions.parseInParallel,
+                                parseCache.get(), threadPool, argErrorStream);
+    taskGroup.Wait();
+  }
+  argErrorStream << errorStream2.str();
+  if (!rootNode1) {
+    argErrorStream << "Failed to parse file: " << file1 << "\n";
+    return 4;
+  }
+  if (!rootNode2) {
+    argErrorStream << "Failed to parse file: " << file2 << "\n";
+    return 5;
+  }
+
+  // Diffs and verifying comparisons walk the trees, which is done on multiple
+  // threads if parsing is as well
+  const auto diffThreadPool =
+      argOptions.parseInParallel ? &threadPool : nullptr;
+
+  if (!argOptions.patchOutputFile.empty()) {
+    DiffEngine diffEngine{false, false, diffThreadPool};
+    const auto differences = diffEngine.Diff(*rootNode1, *rootNode2);
+    PatchWriter patchWriter{argOptions.patchOutputFile, argErrorStream};
+    if (patchWriter.WriteFile(*rootNode1, *rootNode2, differences) ==
+        false) {
+      return 8;
+    }
+    if (differences.empty()) {
+      return 0;
+    }
+    return 1;
+  }
+
+  if (argOptions.compare && argOptions.listDifferences) {
+    DiffEngine diffEngine{argOptions.stopAtFirstDifference, false,
+                          diffThreadPool};
+    const auto differences = diffEngine.Diff(*rootNode1, *rootNode2);
+    for (const auto &difference : differences) {
+      argOutputStream << difference.GetJsonLine() << "\n";
+    }
+    if (differences.empty()) {
+      return 0;
+    }
+    return 1;
+  } else if (argOptions.compare && argOptions.flatCompare) {
+    if (FlatTree{*rootNode1}.Compare(FlatTree{*rootNode2}) == true) {
+      return 0;
+    }
+    return 1;
+  } else if (argOptions.compare && argOptions.verifyHashMatches &&
+             diffThreadPool) {
+    DiffEngine diffEngine{true, true, diffThreadPool};
+    if (diffEngine.Diff(*rootNode1, *rootNode2).empty()) {
+      return 0;
+    }
+    return 1;
+  } else if (argOptions.compare && argOptions.verifyHashMatches) {
+    if (rootNode1->CompareVerified(rootNode2.get()) == true) {
+      return 0;
+    }
+    return 1;
+  } else if (argOptions.compare) {
+    if (rootNode1->Compare(rootNode2.get()) == true) {
+      return 0;
+    }
+    return 1;
+  } else if (argOptions.merge_file_2_into_file_1) {
+    rootNode1->Merge(rootNode2.get(), argOptions.extend, argOptions.purge);
+    if (!argOptions.dtbOutputFile.empty()) {
+      DtbWriter writer{argOptions.dtbOutputFile, argErrorStream};
+      if (writer.WriteFile(*rootNode1) == false) {
+        return 8;
+      }
+      return 0;
+    }
+    PrintTree(*rootNode1, argOptions.outputFormat, argOutputStream);
+    return 0;
+  }
+
+  return 6;
+}
+
+int RunManifest(const std::string &argManifestFile,
+                std::ostream &argOutputStream, std::ostream &argErrorStream) {
+  struct Job {
+    unsigned lineNumber;
+    std::vector<std::string> arguments;
+    int status = 0;
+    double milliseconds = 0.0;
+    std::ostringstream output;
+    std::ostringstream errors;
+  };
+
+  std::ifstream manifestStream{argManifestFile};
+  if (manifestStream.is_open() == false) {
+    argErrorStream << "Failed to open manifest file: " << argManifestFile
+                   << "\n";
+    return 4;
+  }
+
+  // Each non-empty line not starting with '#' holds the options and files of
+  // a job in any order. The options are moved in front of the files like on
+  // the command line.
+  std::vector<std::unique_ptr<Job>> jobs;
+  std::string line;
+  for (unsigned lineNumber = 1; std::getline(manifestStream, line);
+       ++lineNumber) {
+    std::istringstream lineStream{line};
+    std::vector<std::string> tokens{std::istream_iterator<std::string>{
+                                        lineStream},
+                                    std::istream_iterator<std::string>{}};
+    if (tokens.empty() || (tokens.front()[0] == '#')) {
+      continue;
+    }
+    auto job = std::make_unique<Job>();
+    job->lineNumber = lineNumber;
+    std::vector<std::string> files;
+    for (std::vector<std::string>::size_type i = 0; i < tokens.size(); ++i) {
+      if (tokens[i][0] != '-') {
+        files.emplace_back(tokens[i]);
+        continue;
+      }
+      job->arguments.emplace_back(tokens[i]);
+      if ((tokens[i] == "-3") || (tokens[i] == "-b") || (tokens[i] == "-c") ||
+          (tokens[i] == "-d") || (tokens[i] == "-u") || (tokens[i] == "-x")) {
+        if (i + 1 < tokens.size()) {
+          job->arguments.emplace_back(tokens[++i]);
+        }
+      }
+    }
+    job->arguments.insert(std::end(job->arguments), std::begin(files),
+                          std::end(files));
+    jobs.emplace_back(std::move(job));
+  }
+
+  using Clock = std::chrono::steady_clock;
+  const auto startTime = Clock::now();
+  {
+    ThreadPool threadPool;
+    TaskGroup taskGroup{threadPool};
+    for (auto &job : jobs) {
+      taskGroup.Run([&job, &threadPool]() {
+        const auto jobStartTime = Clock::now();
+        try {
+          const auto options = ParseJobOptions(job->arguments);
+          // Watching files never finishes
+          if (options.displayHelp || (options.manifestFile.empty() == false) ||
+              options.watchFiles) {
+            job->errors << "Invalid combination of commandline options\n";
+            job->status = 7;
+          } else {
+            job->status = VerifyJobOptions(options, job->errors);
+            if (job->status == 0) {
+              job->status =
+                  RunJob(options, job->output, job->errors, &threadPool);
+            }
+          }
+        } catch (const std::exception &argException) {
+          job->errors << argException.what() << "\n";
+          job->status = JOB_EXCEPTION_STATUS;
+        }
+        job->milliseconds = std::chrono::duration<double, std::milli>(
+                                Clock::now() - jobStartTime)
+                                .count();
+      });
+    }
+    taskGroup.Wait();
+  }
+  const auto milliseconds =
+      std::chrono::duration<double, std::milli>(Clock::now() - startTime)
+          .count();
+
+  int highestStatus = 0;
+  std::string summary{"{\"jobs\":["};
+  for (const auto &job : jobs) {
+    highestStatus = std::max(highestStatus, job->status);
+    if (&job != &jobs.front()) {
+      summary.push_back(',');
+    }
+    summary.append("\n{\"line\":" + std::to_string(job->lineNumber) +
+                   ",\"arguments\":[");
+    for (const auto &argument : job->arguments) {
+      if (&argument != &job->arguments.front()) {
+        summary.push_back(',');
+      }
+      AppendJsonString(summary, argument);
+    }
+    summary.append("],\"status\":" + std::to_string(job->status) +
+                   ",\"milliseconds\":" + std::to_string(job->milliseconds) +
+                   ",\"output\":");
+    AppendJsonString(summary, job->output.str());
+    summary.append(",\"errors\":");
+    AppendJsonString(summary, job->errors.str());
+    summary.push_back('}');
+  }
+  summary.append("\n],\"milliseconds\":" + std::to_string(milliseconds) +
+                 "}\n");
+  argOutputStream << summary;
+
+  return highestStatus;
+}
+
+int VerifyJobOptions(const JobOptions &argOptions,
+                     std::ostream &argErrorStream) {
+  if ((argOptions.extend && !argOptions.merge_file_2_into_file_1) ||
+      (argOptions.purge && !argOptions.merge_file_2_into_file_1) ||
+      (!argOptions.dtbOutputFile.empty() &&
+       !argOptions.merge_file_2_into_file_1 && argOptions.baseFile.empty() &&
+       !argOptions.applyOverlays && argOptions.patchFile.empty()) ||
+      (argOptions.flatCompare && argOptions.merge_file_2_into_file_1) ||
+      (argOptions.verifyHashMatches &&
+       (argOptions.flatCompare || argOptions.merge_file_2_into_file_1)) ||
+      (argOptions.listDifferences &&
+       (argOptions.flatCompare || argOptions.merge_file_2_into_file_1 ||
+        argOptions.verifyHashMatches)) ||
+      (argOptions.stopAtFirstDifference && !argOptions.listDifferences) ||
+      (argOptions.multipleCandidates &&
+       (argOptions.listDifferences || argOptions.merge_file_2_into_file_1)) ||
+      (argOptions.clusterFiles &&
+       (argOptions.flatCompare || argOptions.listDifferences ||
+        argOptions.merge_file_2_into_file_1 ||
+        argOptions.multipleCandidates || argOptions.verifyHashMatches)) ||
+      (!argOptions.baseFile.empty() &&
+       (argOptions.clusterFiles || argOptions.extend ||
+        argOptions.flatCompare || argOptions.listDifferences ||
+        argOptions.merge_file_2_into_file_1 ||
+        argOptions.multipleCandidates || argOptions.purge ||
+        argOptions.stopAtFirstDifference || argOptions.verifyHashMatches)) ||
+      (argOptions.applyOverlays &&
+       (!argOptions.baseFile.empty() || argOptions.clusterFiles ||
+        argOptions.extend || argOptions.flatCompare ||
+        argOptions.listDifferences || argOptions.merge_file_2_into_file_1 ||
+        argOptions.multipleCandidates || argOptions.purge ||
+        argOptions.stopAtFirstDifference || argOptions.verifyHashMatches)) ||
+      ((!argOptions.patchFile.empty() || !argOptions.patchOutputFile.empty()) &&
+       (argOptions.applyOverlays || !argOptions.baseFile.empty() ||
+        argOptions.clusterFiles || argOptions.extend ||
+        argOptions.flatCompare || argOptions.listDifferences ||
+        argOptions.merge_file_2_into_file_1 ||
+        argOptions.multipleCandidates || argOptions.purge ||
+        argOptions.stopAtFirstDifference || argOptions.verifyHashMatches)) ||
+      (!argOptions.patchFile.empty() &&
+       (!argOptions.patchOutputFile.empty() ||
+        (argOptions.files.size() > 1))) ||
+      (!argOptions.patchOutputFile.empty() &&
+       !argOptions.dtbOutputFile.empty()) ||
+      ((argOptions.outputFormat != OutputFormat::DTS) &&
+       (!argOptions.dtbOutputFile.empty() || argOptions.clusterFiles ||
+        argOptions.flatCompare || argOptions.listDifferences ||
+        argOptions.multipleCandidates || !argOptions.patchOutputFile.empty() ||
+        argOptions.stopAtFirstDifference || argOptions.verifyHashMatches ||
+        ((argOptions.files.size() > 1) &&
+         !argOptions.merge_file_2_into_file_1 &&
+         argOptions.baseFile.empty() && !argOptions.applyOverlays &&
+         argOptions.patchFile.empty()))) ||
+      (argOptions.watchFiles &&
+       (argOptions.applyOverlays || !argOptions.baseFile.empty() ||
+        !argOptions.cacheDirectory.empty() || argOptions.clusterFiles ||
+        !argOptions.dtbOutputFile.empty() || argOptions.extend ||
+        argOptions.flatCompare || argOptions.listDifferences ||
+        argOptions.merge_file_2_into_file_1 ||
+        argOptions.multipleCandidates || !argOptions.patchFile.empty() ||
+        !argOptions.patchOutputFile.empty() || argOptions.purge ||
+        argOptions.stopAtFirstDifference || argOptions.verifyHashMatches ||
+        (argOptions.outputFormat != OutputFormat::DTS) ||
+        (argOptions.files.size() > 2)))) {
+    argErrorStream << "Invalid combination of commandline options\n";
+    return 7;
+  }
+
+  if (!argOptions.patchFile.empty() && argOptions.files.empty()) {
+    argErrorStream << "A positional argument is required - the file to be "
+                      "patched\n";
+    return 3;
+  }
+  if ((argOptions.outputFormat != OutputFormat::DTS) &&
+      (argOptions.files.size() == 1) && !argOptions.merge_file_2_into_file_1 &&
+      argOptions.baseFile.empty() && !argOptions.applyOverlays) {
+    return 0;
+  }
+  if (argOptions.patchFile.empty() && (argOptions.files.size() < 2)) {
+    argErrorStream << "At least two positional arguments are required - the "
+                      "two files to be compared\n";
+    return 3;
+  }
+
+  return 0;
+}
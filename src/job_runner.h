@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef JOB_RUNNER_H
+#define JOB_RUNNER_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// Representation in which resulting device trees are printed
+enum class OutputFormat {
+  DTS,
+  JSON,
+  JSON_LINES,
+};
+
+// Settings of a single comparison or merge as given on the command line
+struct JobOptions {
+  bool applyOverlays = false;
+  bool clusterFiles = false;
+  bool compare = true;
+  bool displayHelp = false;
+  bool extend = false;
+  bool flatCompare = false;
+  bool listDifferences = false;
+  bool merge_file_2_into_file_1 = false;
+  bool multipleCandidates = false;
+  bool purge = false;
+  bool parseInParallel = false;
+  bool stopAtFirstDifference = false;
+  bool verifyHashMatches = false;
+  bool watchFiles = false;
+  OutputFormat outputFormat = OutputFormat::DTS;
+  std::string baseFile;
+  std::string cacheDirectory;
+  std::string dtbOutputFile;
+  std::string manifestFile;
+  std::string patchFile;
+  std::string patchOutputFile;
+  std::vector<std::string> files;
+};
+
+// Parse the options and files of a job, of which the options come first
+JobOptions ParseJobOptions(const std::vector<std::string> &argArguments);
+// Run a comparison or merge and return its exit status. Its tasks run on the
+// given thread pool or on one of its own.
+int RunJob(const JobOptions &argOptions, std::ostream &argOutputStream,
+           std::ostream &argErrorStream, ThreadPool *argThreadPool = nullptr);
+// Run the jobs of a manifest file concurrently and print a JSON summary of
+// their results. Return the highest exit status of all jobs.
+int RunManifest(const std::string &argManifestFile,
+                std::ostream &argOutputStream, std::ostream &argErrorStream);
+// Return 0 if the options can be combined or the exit status reporting it
+int VerifyJobOptions(const JobOptions &argOptions,
+                     std::ostream &argErrorStream);
+
+#endif // JOB_RUNNER_H
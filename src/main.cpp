@@ -21,8 +21,7 @@
  * SOFTWARE.
  */
 
-#include "device_tree_parser.h"
-#include "root_node.h"
+#include "job_runner.h"
 
 #include <iostream>
 
@@ -33,85 +32,115 @@ int main(int argc, char *argv[]) {
     return 2;
   }
 
-  bool compare = true;
-  bool displayHelp = false;
-  bool extend = false;
-  bool merge_file_2_into_file_1 = false;
-  bool purge = false;
-  for (auto i = 1; i < argc; ++i) {
-    if (std::string{argv[i]} == "-e") {
-      extend = true;
-    }
-    if (std::string{argv[i]} == "-h") {
-      displayHelp = true;
-      break;
-    }
-    if (std::string{argv[i]} == "-m") {
-      compare = false;
-      merge_file_2_into_file_1 = true;
-    }
-    if (std::string{argv[i]} == "-p") {
-      purge = true;
-    }
-  }
+  const auto options = ParseJobOptions({argv + 1, argv + argc});
 
-  if (displayHelp) {
+  if (options.displayHelp) {
     std::cout
-        << "DeviceTreeComparer [OPTIONS] FILE_1 FILE_2\n\n"
+        << "DeviceTreeComparer [OPTIONS] FILE_1 FILE_2 [FILE_3 ...]\n"
+        << "DeviceTreeComparer -a [OPTIONS] BASE_FILE OVERLAY_FILE "
+           "[OVERLAY_FILE ...]\n"
+        << "DeviceTreeComparer -3 BASE_FILE [OPTIONS] OUR_FILE THEIR_FILE\n"
+        << "DeviceTreeComparer -x PATCH_FILE [OPTIONS] FILE\n"
+        << "DeviceTreeComparer -j|-J [OPTIONS] FILE\n"
+        << "DeviceTreeComparer -w [OPTIONS] FILE_1 FILE_2\n"
+        << "DeviceTreeComparer -b MANIFEST\n\n"
         << "Without any options this tool compares the two device tree "
            "source files and\nreturns '0' if they are equal or '1' if "
-           "they differ.\n\n"
+           "they differ. Device tree blobs (.dtb)\nare detected by their "
+           "magic number and can be used in place of source files, as\n"
+           "can JSON exports written by \"-j\". A blob compiled by dtc "
+           "differs from its\nsource if the source contains references to "
+           "labels, which dtc replaces by\nphandle values and adds "
+           "\"phandle\" properties for, or empty cell lists "
+           "(\"<>\"),\nwhich are read back as empty properties.\n\n"
         << "Options:\n"
+        << "\t-3 BASE_FILE: Merge the changes of OUR_FILE and THEIR_FILE "
+           "relative to their\n\t    common ancestor BASE_FILE and print "
+           "the result. Conflicting changes\n\t    keep OUR_FILE's version "
+           "and are listed as JSON objects, one per line,\n\t    on "
+           "stderr (only in combination with \"-c\", \"-d\" or \"-t\")\n"
+        << "\t-a: Apply the overlays (\"/plugin/;\" sources with "
+           "\"fragment@N\" nodes\n\t    targeting a label or path) to "
+           "BASE_FILE in order and print the result\n\t    (only in "
+           "combination with \"-c\", \"-d\" or \"-t\")\n"
+        << "\t-b MANIFEST: Run the jobs listed in MANIFEST concurrently and "
+           "print a JSON\n\t    summary of their results. Each line holds "
+           "the options and files of one\n\t    job, lines starting with "
+           "'#' are ignored (not in combination with other\n\t    options "
+           "or files)\n"
+        << "\t-c CACHE_DIR: Load device tree source files parsed before "
+           "from the cache in\n\t    CACHE_DIR instead of parsing them "
+           "again and add newly parsed ones to it\n"
+        << "\t-d DTB_FILE: Write the result as device tree blob to DTB_FILE "
+           "instead of\n\t    printing it. The memory reservation map of "
+           "blobs read is dropped and\n\t    the written blob has an empty "
+           "one (only in combination with \"-3\",\n\t    \"-a\", \"-m\" "
+           "or \"-x\")\n"
         << "\t-e: Add entries which are in FILE_2 but not in FILE_1 to "
            "FILE_1 (only\n\t    in combination with \"-m\")\n"
+        << "\t-f: Compare flattened copies of the device trees, which is "
+           "faster for large\n\t    trees (not in combination with "
+           "\"-m\")\n"
+        << "\t-g: Group the files into clusters of identical and nearly "
+           "identical device\n\t    trees and print each cluster as JSON "
+           "object on a line of its own (only\n\t    in combination with "
+           "\"-c\" or \"-t\")\n"
         << "\t-h: Display this help text\n"
+        << "\t-j: Print resulting device trees as a single JSON document "
+           "instead of device\n\t    tree source or export FILE if it is "
+           "the only one given (not in\n\t    combination with \"-d\", "
+           "\"-f\", \"-g\", \"-l\", \"-n\", \"-u\" or \"-v\")\n"
+        << "\t-J: Like \"-j\", but print one JSON object with the path "
+           "and the properties\n\t    of each node per line\n"
+        << "\t-l: List the differences as JSON objects, one per line, on "
+           "stdout (not in\n\t    combination with \"-f\", \"-m\" or "
+           "\"-v\")\n"
         << "\t-m: Overwrite options of FILE_1 found both in FILE_1 and "
            "FILE_2 with\n\t    FILE_2's values and print the result to "
            "stdout\n"
+        << "\t-n: Compare FILE_1 against each of the following files "
+           "concurrently and\n\t    print one result per file (only in "
+           "combination with \"-f\", \"-t\" or\n\t    \"-v\")\n"
         << "\t-p: Purge entries which are in FILE_1 but not in FILE_2 from "
-           "FILE_1\n\t    (only in combination with \"-m\")\n";
+           "FILE_1\n\t    (only in combination with \"-m\")\n"
+        << "\t-s: Stop listing the differences after the first one (only "
+           "in combination\n\t    with \"-l\")\n"
+        << "\t-t: Parse the subtrees below the root nodes of device tree "
+           "source files on\n\t    multiple threads, which also applies to "
+           "\"-l\" and \"-v\"\n"
+        << "\t-u PATCH_FILE: Additionally write the differences turning "
+           "FILE_1 into FILE_2\n\t    to PATCH_FILE (only in combination "
+           "with \"-c\" or \"-t\")\n"
+        << "\t-v: Compare all entries of subtrees with equal hashes instead "
+           "of trusting\n\t    the hashes (not in combination with \"-f\" "
+           "or \"-m\")\n"
+        << "\t-w: Watch both files and list their differences like \"-l\" "
+           "whenever one of\n\t    them is modified, each time followed by "
+           "a summary line. Only the nodes\n\t    enclosing the changes "
+           "are parsed and diffed again. Node and property\n\t    names, "
+           "unit addresses and labels of all revisions are kept in "
+           "memory.\n\t    Stops on SIGINT or SIGTERM with the result of the "
+           "last comparison\n\t    (only in combination with "
+           "\"-t\", not in manifests)\n"
+        << "\t-x PATCH_FILE: Apply PATCH_FILE written by \"-u\" to FILE and "
+           "print the\n\t    result (only in combination with \"-c\", "
+           "\"-d\" or \"-t\")\n";
 
     return 0;
   }
 
-  if ((extend && !merge_file_2_into_file_1) ||
-      (purge && !merge_file_2_into_file_1)) {
-    std::cerr << "Invalid combination of commandline options\n";
-    return 7;
-  }
-
-  if (argc < 3) {
-    std::cerr << "At least two positional arguments are required - the two "
-                 "files to be compared\n";
-    return 3;
-  }
-
-  const std::string file1{argv[argc - 2]};
-  const std::string file2{argv[argc - 1]};
-
-  DeviceTreeParser parserFile1{file1};
-  const auto rootNode1 = parserFile1.ParseFile();
-  if (!rootNode1) {
-    std::cerr << "Failed to parse file: " << file1 << "\n";
-    return 4;
-  }
-  DeviceTreeParser parserFile2{file2};
-  const auto rootNode2 = parserFile2.ParseFile();
-  if (!rootNode2) {
-    std::cerr << "Failed to parse file: " << file2 << "\n";
-    return 5;
+  if (options.manifestFile.empty() == false) {
+    if (argc != 3) {
+      std::cerr << "Invalid combination of commandline options\n";
+      return 7;
+    }
+    return RunManifest(options.manifestFile, std::cout, std::cerr);
   }
 
-  if (compare) {
-    if (rootNode1->Compare(rootNode2.get()) == true) {
-      return 0;
-    }
-    return 1;
-  } else if (merge_file_2_into_file_1) {
-    rootNode1->Merge(rootNode2.get(), extend, purge);
-    rootNode1->Print();
-    return 0;
+  const auto status = VerifyJobOptions(options, std::cerr);
+  if (status != 0) {
+    return status;
   }
 
-  return 6;
+  return RunJob(options, std::cout, std::cerr);
 }
@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "dtb_parser.h"
+#include "dtb_writer.h"
+#include "device_tree_parser.h"
+#include "property.h"
+#include "root_node.h"
+
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Return the cells of a property or an empty vector if it does not exist
+static std::vector<uint32_t> GetCells(const RootNode &argRootNode,
+                                      const std::string_view argNodePath,
+                                      const std::string_view argPropName) {
+  const auto node = argRootNode.Find(argNodePath);
+  if (node == nullptr) {
+    return {};
+  }
+  for (const auto &item : node->GetItems()) {
+    const auto property = dynamic_cast<const PropertyValueU32 *>(item);
+    if ((property != nullptr) && (property->GetName() == argPropName)) {
+      return {std::begin(property->GetCells()),
+              std::end(property->GetCells())};
+    }
+  }
+  return {};
+}
+
+static uint32_t ReadBigEndianU32(const std::string &argBlob,
+                                 const std::string::size_type argOffset) {
+  uint32_t value = 0;
+  for (auto i = 0u; i < sizeof(uint32_t); ++i) {
+    value = (value << 8) | static_cast<unsigned char>(argBlob[argOffset + i]);
+  }
+  return value;
+}
+
+// Return whether all properties of each node precede its subnodes
+static bool ArePropertiesBeforeSubnodes(const std::string &argBlob) {
+  constexpr uint32_t FDT_BEGIN_NODE = 1;
+  constexpr uint32_t FDT_END_NODE = 2;
+  constexpr uint32_t FDT_PROP = 3;
+  constexpr uint32_t FDT_END = 9;
+
+  auto offset = ReadBigEndianU32(argBlob, 8);
+  const auto offDtStrings = ReadBigEndianU32(argBlob, 12);
+  // Whether the innermost open node already had a subnode
+  std::vector<bool> hadSubnode;
+  while (offset < offDtStrings) {
+    const auto token = ReadBigEndianU32(argBlob, offset);
+    offset += 4;
+    switch (token) {
+    case FDT_BEGIN_NODE:
+      if (hadSubnode.empty() == false) {
+        hadSubnode.back() = true;
+      }
+      hadSubnode.push_back(false);
+      offset = (argBlob.find('\0', offset) + 4) & ~3u;
+      break;
+    case FDT_END_NODE:
+      hadSubnode.pop_back();
+      break;
+    case FDT_PROP:
+      if (hadSubnode.back() == true) {
+        return false;
+      }
+      offset = (offset + 8 + ReadBigEndianU32(argBlob, offset) + 3) & ~3u;
+      break;
+    case FDT_END:
+      return true;
+    default:
+      return false;
+    }
+  }
+  return false;
+}
+
+static bool TestReferencesAreResolved(const std::string &argDataDirectory) {
+  DeviceTreeParser parser{argDataDirectory + "/references.dts"};
+  const auto rootNode = parser.ParseFile();
+  if (!rootNode) {
+    std::cerr << "Failed to parse the source of the written tree\n";
+    return false;
+  }
+  DtbWriter writer{"references.dtb"};
+  if (writer.WriteFile(*rootNode) == false) {
+    std::cerr << "Failed to write a tree with references\n";
+    return false;
+  }
+
+  std::ifstream blobFile{"references.dtb", std::ios_base::binary};
+  const std::string blob{std::istreambuf_iterator<char>{blobFile},
+                         std::istreambuf_iterator<char>{}};
+  if (ArePropertiesBeforeSubnodes(blob) == false) {
+    std::cerr << "Properties were written after subnodes\n";
+    return false;
+  }
+
+  DtbParser dtbParser{"references.dtb"};
+  const auto writtenRootNode = dtbParser.ParseFile();
+  if (!writtenRootNode) {
+    std::cerr << "Failed to parse the written tree\n";
+    return false;
+  }
+
+  // The existing phandle of the clock is kept, while the interrupt
+  // controller is assigned the next free one
+  const std::vector<uint32_t> clockPhandle{0x7};
+  const std::vector<uint32_t> gicPhandle{0x8};
+  const std::vector<uint32_t> clocks{0x7, 0x8};
+  const std::vector<uint32_t> interrupts{0x8, 0x1, 0x2};
+  if ((GetCells(*writtenRootNode, "/soc/clock@2000", "phandle") !=
+       clockPhandle) ||
+      (GetCells(*writtenRootNode, "/soc/interrupt-controller@1000",
+                "phandle") != gicPhandle) ||
+      (GetCells(*writtenRootNode, "/", "interrupt-parent") != gicPhandle) ||
+      (GetCells(*writtenRootNode, "/soc/serial@3000", "clocks") != clocks) ||
+      (GetCells(*writtenRootNode, "/soc/serial@3000", "interrupts") !=
+       interrupts)) {
+    std::cerr << "References were not resolved to the expected phandles\n";
+    return false;
+  }
+
+  return true;
+}
+
+static bool TestUnresolvedReferenceFails(const std::string &argDataDirectory) {
+  DeviceTreeParser parser{argDataDirectory + "/unresolved_reference.dts"};
+  const auto rootNode = parser.ParseFile();
+  if (!rootNode) {
+    std::cerr << "Failed to parse the source of the written tree\n";
+    return false;
+  }
+  DtbWriter writer{"unresolved_reference.dtb"};
+  if (writer.WriteFile(*rootNode) == true) {
+    std::cerr << "Wrote a tree with an unresolved reference\n";
+    return false;
+  }
+
+  return true;
+}
+
+static bool TestDeeplyNestedBlobFails() {
+  constexpr auto DEPTH = 600;
+
+  std::ofstream sourceFile{"deeply_nested.dts"};
+  sourceFile << "/dts-v1/;\n\n/ {\n";
+  for (auto i = 1; i <= DEPTH; ++i) {
+    sourceFile << std::string(i, '\t') << "n {\n";
+  }
+  for (auto i = DEPTH; i >= 1; --i) {
+    sourceFile << std::string(i, '\t') << "};\n";
+  }
+  sourceFile << "};\n";
+  sourceFile.close();
+
+  DeviceTreeParser parser{"deeply_nested.dts"};
+  const auto rootNode = parser.ParseFile();
+  if (!rootNode) {
+    std::cerr << "Failed to parse the source of the deeply nested tree\n";
+    return false;
+  }
+  DtbWriter writer{"deeply_nested.dtb"};
+  if (writer.WriteFile(*rootNode) == false) {
+    std::cerr << "Failed to write the deeply nested tree\n";
+    return false;
+  }
+
+  DtbParser dtbParser{"deeply_nested.dtb"};
+  try {
+    dtbParser.ParseFile();
+  } catch (const std::exception &) {
+    return true;
+  }
+  std::cerr << "Parsed a blob exceeding the nesting limit\n";
+  return false;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 2) {
+    std::cerr << "The directory holding the test data is required\n";
+    return 2;
+  }
+
+  const std::string dataDirectory{argv[1]};
+  bool passed = TestReferencesAreResolved(dataDirectory);
+  passed = TestUnresolvedReferenceFails(dataDirectory) && passed;
+  passed = TestDeeplyNestedBlobFails() && passed;
+  if (passed == false) {
+    return 1;
+  }
+  return 0;
+}
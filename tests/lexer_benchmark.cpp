@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "lexer.h"
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <regex>
+#include <string>
+#include <vector>
+
+// The expression Property::Construct matched property lines with before the
+// scanner replaced it
+static const std::regex propertyNameRegex{
+    "^\\t+([0-9a-zA-Z,._+?#-]+)( = |;)"};
+
+// Typical property lines of device tree sources
+static const std::vector<std::string> PROPERTY_LINES{
+    "\tstatus;",
+    "\tstatus = \"okay\";",
+    "\t\t\treg = <0x1000 0x100>;",
+    "\t#address-cells = <1>;",
+    "\tlinux,phandle = <0x1>;",
+    "\tcompatible = \"vendor,foo\", \"vendor,bar\";",
+    "\tmac-address = [00 11 22 33 44 55];",
+    "\t\tinterrupts = <0x0 0x25 0x4>;",
+};
+
+// Report the time both approaches take for scanning the property lines
+int main() {
+  constexpr std::size_t ITERATIONS = 20000;
+
+  std::size_t regexMatches = 0;
+  const auto regexStart = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < ITERATIONS; ++i) {
+    for (const auto &line : PROPERTY_LINES) {
+      std::smatch match;
+      regexMatches += std::regex_search(line, match, propertyNameRegex);
+    }
+  }
+  const auto scannerStart = std::chrono::steady_clock::now();
+  std::size_t scannerMatches = 0;
+  for (std::size_t i = 0; i < ITERATIONS; ++i) {
+    for (const auto &line : PROPERTY_LINES) {
+      PropertyToken token;
+      scannerMatches += ScanPropertyLine(line, token);
+    }
+  }
+  const auto scannerEnd = std::chrono::steady_clock::now();
+
+  using std::chrono::duration_cast;
+  using std::chrono::milliseconds;
+  std::cout << "Scanned " << ITERATIONS * PROPERTY_LINES.size()
+            << " lines: regular expression " << regexMatches << " matches in "
+            << duration_cast<milliseconds>(scannerStart - regexStart).count()
+            << " ms, scanner " << scannerMatches << " matches in "
+            << duration_cast<milliseconds>(scannerEnd - scannerStart).count()
+            << " ms\n";
+  return 0;
+}
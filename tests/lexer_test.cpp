@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "lexer.h"
+
+#include <iostream>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// The expression Property::Construct matched property lines with before the
+// scanner replaced it
+static const std::regex propertyNameRegex{
+    "^\\t+([0-9a-zA-Z,._+?#-]+)( = |;)"};
+
+// Lines which the former regular expression accepted or rejected
+static const std::vector<std::string> PROPERTY_LINES{
+    "\tstatus;",
+    "\tstatus = \"okay\";",
+    "\t\t\treg = <0x1000 0x100>;",
+    "\t#address-cells = <1>;",
+    "\tlinux,phandle = <0x1>;",
+    "\tcompatible = \"vendor,foo\", \"vendor,bar\";",
+    "\tmac-address = [00 11 22 33 44 55];",
+    "\tfoo?bar+baz_1.2 = <2>;",
+    "\tstatus = \"okay\";\r",
+    "\tstatus = \"okay\";  ",
+    "\tstatus = \"okay\" ;",
+    "\tempty = ;",
+    "\tnoterminator;\r",
+    "status = \"okay\";",
+    "    status = \"okay\";",
+    "\t",
+    "\t = <1>;",
+    "\tstatus=\"okay\";",
+    "\tstatus  = \"okay\";",
+    "\tstatus",
+    "\tstat/us = <1>;",
+    "\tlabel: status = <1>;",
+    "\t};",
+    "\tnode@0 {",
+};
+
+// Lines which the former regular expression accepted, but dtc rejects for
+// their missing semicolon
+static const std::vector<std::string> UNTERMINATED_LINES{
+    "\tstatus = \"okay\"",
+    "\treg = <0x1000 0x100>  ",
+    "\tstatus = ",
+};
+
+static bool TestScannerMatchesRegex() {
+  bool passed = true;
+  for (const auto &line : PROPERTY_LINES) {
+    std::smatch match;
+    const auto regexAccepts = std::regex_search(line, match, propertyNameRegex);
+    PropertyToken token;
+    const auto scannerAccepts = ScanPropertyLine(line, token);
+    if ((scannerAccepts != regexAccepts) ||
+        ((scannerAccepts == true) && (token.name != match.str(1)))) {
+      std::cerr << "Scanner and regular expression disagree on line: \""
+                << line << "\"\n";
+      passed = false;
+    }
+  }
+  return passed;
+}
+
+static bool TestUnterminatedValuesAreRejected() {
+  bool passed = true;
+  for (const auto &line : UNTERMINATED_LINES) {
+    PropertyToken token;
+    if (ScanPropertyLine(line, token) == true) {
+      std::cerr << "Scanner accepted unterminated line: \"" << line << "\"\n";
+      passed = false;
+    }
+  }
+  return passed;
+}
+
+static bool TestValuesAreExtracted() {
+  const std::vector<std::pair<std::string, std::string_view>> lines{
+      {"\tstatus = \"okay\";", "\"okay\""},
+      {"\tstatus = \"okay\" ;\r", "\"okay\""},
+      {"\treg = <0x1000  0x100>;", "<0x1000  0x100>"},
+      {"\tempty = ;", ""},
+  };
+  bool passed = true;
+  for (const auto &line : lines) {
+    PropertyToken token;
+    if ((ScanPropertyLine(line.first, token) == false) ||
+        (token.hasValue == false) || (token.value != line.second)) {
+      std::cerr << "Scanner extracted wrong value from line: \""
+                << line.first << "\"\n";
+      passed = false;
+    }
+  }
+  PropertyToken token;
+  if ((ScanPropertyLine("\tstatus;", token) == false) ||
+      (token.hasValue == true)) {
+    std::cerr << "Scanner extracted a value from an empty property\n";
+    passed = false;
+  }
+  return passed;
+}
+
+int main() {
+  bool passed = TestScannerMatchesRegex();
+  passed = TestUnterminatedValuesAreRejected() && passed;
+  passed = TestValuesAreExtracted() && passed;
+  if (passed == false) {
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2020 Markus Prasser
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "device_tree_parser.h"
+#include "property.h"
+#include "root_node.h"
+#include "three_way_merge.h"
+
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Return the cells of a property or an empty vector if it does not exist
+static std::vector<uint32_t> GetCells(const RootNode &argRootNode,
+                                      const std::string_view argNodePath,
+                                      const std::string_view argPropName) {
+  const auto node = argRootNode.Find(argNodePath);
+  if (node == nullptr) {
+    return {};
+  }
+  for (const auto &item : node->GetItems()) {
+    const auto property = dynamic_cast<const PropertyValueU32 *>(item);
+    if ((property != nullptr) && (property->GetName() == argPropName)) {
+      return {std::begin(property->GetCells()),
+              std::end(property->GetCells())};
+    }
+  }
+  return {};
+}
+
+static std::unique_ptr<RootNode> Parse(const std::string &argFilePath) {
+  DeviceTreeParser parser{argFilePath};
+  auto rootNode = parser.ParseFile();
+  if (!rootNode) {
+    std::cerr << "Failed to parse \"" << argFilePath << "\"\n";
+  }
+  return rootNode;
+}
+
+// A node and a property sharing a name must each be merged with their own
+// counterpart instead of replacing one another
+static bool TestNodeAndPropertyOfSameName(const std::string &argDataDirectory,
+                                          const bool argAddFromOther) {
+  const auto ourRootNode = Parse(argDataDirectory + "/merge_ours.dts");
+  const auto theirRootNode = Parse(argDataDirectory + "/merge_theirs.dts");
+  if (!ourRootNode || !theirRootNode) {
+    return false;
+  }
+  ourRootNode->Merge(theirRootNode.get(), argAddFromOther, false);
+
+  if ((GetCells(*ourRootNode, "/", "foo") != std::vector<uint32_t>{3}) ||
+      (GetCells(*ourRootNode, "/foo", "bar") != std::vector<uint32_t>{4}) ||
+      (GetCells(*ourRootNode, "/", "baz") != std::vector<uint32_t>{5})) {
+    std::cerr << "A node and a property of the same name were mixed up\n";
+    return false;
+  }
+  const auto hasAddedNode =
+      GetCells(*ourRootNode, "/baz", "qux") == std::vector<uint32_t>{6};
+  if (hasAddedNode != argAddFromOther) {
+    std::cerr << "A node sharing its name with a property was "
+              << (argAddFromOther ? "not added" : "added") << '\n';
+    return false;
+  }
+
+  return true;
+}
+
+// Likewise the three-way merge must compare a node only with the nodes and a
+// property only with the properties of the other trees
+static bool
+TestThreeWayNodeAndPropertyOfSameName(const std::string &argDataDirectory) {
+  const auto baseRootNode = Parse(argDataDirectory + "/three_way_base.dts");
+  const auto ourRootNode = Parse(argDataDirectory + "/three_way_ours.dts");
+  const auto theirRootNode = Parse(argDataDirectory + "/three_way_theirs.dts");
+  if (!baseRootNode || !ourRootNode || !theirRootNode) {
+    return false;
+  }
+  ThreeWayMerge threeWayMerge;
+  const auto conflicts =
+      threeWayMerge.Merge(*ourRootNode, *baseRootNode, *theirRootNode);
+
+  if ((conflicts.size() != 1) || (conflicts.front().path != "/foo") ||
+      (conflicts.front().ourItem->GetType() != Item::Type::PROPERTY) ||
+      (conflicts.front().ourItem->GetName() != "bar")) {
+    std::cerr << "The conflicting property below a node sharing its name with "
+                 "a property was not reported\n";
+    return false;
+  }
+  if ((GetCells(*ourRootNode, "/", "foo") != std::vector<uint32_t>{3}) ||
+      (GetCells(*ourRootNode, "/foo", "bar") != std::vector<uint32_t>{2})) {
+    std::cerr << "A node and a property of the same name were mixed up in a "
+                 "three-way merge\n";
+    return false;
+  }
+
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 2) {
+    std::cerr << "The directory holding the test data is required\n";
+    return 2;
+  }
+
+  const std::string dataDirectory{argv[1]};
+  bool passed = TestNodeAndPropertyOfSameName(dataDirectory, false);
+  passed = TestNodeAndPropertyOfSameName(dataDirectory, true) && passed;
+  passed = TestThreeWayNodeAndPropertyOfSameName(dataDirectory) && passed;
+  if (passed == false) {
+    return 1;
+  }
+  return 0;
+}